@@ -0,0 +1,133 @@
+/*
+ * Skyline rectangle packer for texture atlases
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include "atlas.h"
+
+void Atlas_Init(atlas_t *atlas, int width, int height)
+{
+	atlas->width = width;
+	atlas->height = height;
+	atlas->nodes = (atlas_node_t *)malloc(sizeof(*atlas->nodes) * width);
+	atlas->nodes[0].x = 0;
+	atlas->nodes[0].y = 0;
+	atlas->nodes[0].width = width;
+	atlas->numnodes = 1;
+	atlas->usedarea = 0;
+	atlas->numallocs = 0;
+}
+
+void Atlas_Shutdown(atlas_t *atlas)
+{
+	free(atlas->nodes);
+	atlas->nodes = NULL;
+	atlas->numnodes = 0;
+}
+
+/* returns the y a w x h rectangle would sit at with its left edge on node i, or -1 */
+static int Atlas_Fit(const atlas_t *atlas, int i, int w, int h)
+{
+	if (atlas->nodes[i].x + w > atlas->width)
+		return -1;
+
+	int y = 0;
+	for (int left = w; left > 0; left -= atlas->nodes[i].width, i++)
+	{
+		if (atlas->nodes[i].y > y)
+			y = atlas->nodes[i].y;
+		if (y + h > atlas->height)
+			return -1;
+	}
+
+	return y;
+}
+
+bool Atlas_Alloc(atlas_t *atlas, int w, int h, int *x, int *y)
+{
+	int best = -1, besttop = INT_MAX, bestwidth = INT_MAX;
+
+	for (int i = 0; i < atlas->numnodes; i++)
+	{
+		int fit = Atlas_Fit(atlas, i, w, h);
+		if (fit < 0)
+			continue;
+
+		int top = fit + h;
+		if (top < besttop || (top == besttop && atlas->nodes[i].width < bestwidth))
+		{
+			best = i;
+			besttop = top;
+			bestwidth = atlas->nodes[i].width;
+			*x = atlas->nodes[i].x;
+			*y = fit;
+		}
+	}
+
+	if (best < 0)
+		return false;
+
+	// the new segment replaces whatever it covers
+	int right = *x + w;
+	int last = best;
+	while (last < atlas->numnodes && atlas->nodes[last].x + atlas->nodes[last].width <= right)
+		last++;
+
+	// last is the first node reaching past the new segment, trim its left side
+	if (last < atlas->numnodes && atlas->nodes[last].x < right)
+	{
+		atlas->nodes[last].width -= right - atlas->nodes[last].x;
+		atlas->nodes[last].x = right;
+	}
+
+	atlas_node_t node = { *x, besttop, w };
+	int removed = last - best;
+	memmove(&atlas->nodes[best + 1], &atlas->nodes[last], sizeof(*atlas->nodes) * (atlas->numnodes - last));
+	atlas->numnodes += 1 - removed;
+	atlas->nodes[best] = node;
+
+	// merge neighbors at the same height so the skyline stays short
+	for (int i = (best > 0 ? best - 1 : 0); i + 1 < atlas->numnodes && i <= best; )
+	{
+		if (atlas->nodes[i].y == atlas->nodes[i + 1].y)
+		{
+			atlas->nodes[i].width += atlas->nodes[i + 1].width;
+			memmove(&atlas->nodes[i + 1], &atlas->nodes[i + 2], sizeof(*atlas->nodes) * (atlas->numnodes - i - 2));
+			atlas->numnodes--;
+			best--;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	atlas->usedarea += w * h;
+	atlas->numallocs++;
+
+	return true;
+}
+
+int Atlas_Top(const atlas_t *atlas)
+{
+	int top = 0;
+
+	for (int i = 0; i < atlas->numnodes; i++)
+		if (atlas->nodes[i].y > top)
+			top = atlas->nodes[i].y;
+
+	return top;
+}
@@ -0,0 +1,43 @@
+/*
+ * Skyline rectangle packer for texture atlases
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef __ATLAS_H
+#define __ATLAS_H
+
+/*
+ * The skyline is the top edge of everything packed so far, kept as a
+ * left to right run of horizontal segments. A new rectangle goes where
+ * its top ends up lowest, preferring the narrowest segment on ties.
+ * Nothing here touches the renderer, so it can be driven headless.
+ */
+typedef struct atlas_node_s
+{
+	int x, y, width;
+} atlas_node_t;
+
+typedef struct atlas_s
+{
+	int width, height;
+	int numnodes;
+	atlas_node_t *nodes; // room for width nodes, one per column at most
+	int usedarea; // texels handed out
+	int numallocs;
+} atlas_t;
+
+void Atlas_Init(atlas_t *atlas, int width, int height);
+void Atlas_Shutdown(atlas_t *atlas);
+bool Atlas_Alloc(atlas_t *atlas, int w, int h, int *x, int *y);
+int Atlas_Top(const atlas_t *atlas); // highest point of the skyline
+
+#endif /* __ATLAS_H */
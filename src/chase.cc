@@ -29,9 +29,10 @@ cvar_t chase_active = { "chase_active", "0" };
 static void Chase_TraceLine(vec3_t start, vec3_t end, vec3_t impact)
 {
 	trace_t trace;
+	hull_t *hull = &cl.worldmodel->brushmodel->hulls[0];
 
 	memset(&trace, 0, sizeof(trace));
-	SV_RecursiveHullCheck(cl.worldmodel->brushmodel->hulls, 0, 0, 1, start, end, &trace);
+	SV_HullCheck(hull, hull->firstnode, 0, 1, start, end, &trace);
 
 	VectorCopy(trace.endpos, impact);
 }
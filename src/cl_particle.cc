@@ -23,10 +23,7 @@ static const int ramp1[8] = { 0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61 };
 static const int ramp2[8] = { 0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66 };
 static const int ramp3[8] = { 0x6d, 0x6b, 0x06, 0x05, 0x04, 0x03, 0x00, 0x00 };
 
-particle_t *active_particles;
-static particle_t *free_particles;
-static particle_t *particles;
-static int numparticles;
+particles_t cl_particles;
 
 #define NUMVERTEXNORMALS 162
 const float r_avertexnormals[NUMVERTEXNORMALS][3] = {
@@ -35,19 +32,102 @@ const float r_avertexnormals[NUMVERTEXNORMALS][3] = {
 
 static vec3_t avelocities[NUMVERTEXNORMALS];
 
-static particle_t *CL_GetParticle()
+/* how each type moves, applied per particle so the integrator never branches */
+typedef struct
 {
-	if (!free_particles)
-		return NULL;
+	float accel_xy;
+	float accel_z;
+	float gravity;
+	float rampspeed;
+	float ramplimit;
+	const int *ramp;
+} ptypeinfo_t;
+
+static const ptypeinfo_t ptypeinfo[] = {
+	{ 0, 0, 0, 0, 0, NULL }, // pt_static
+	{ 0, 0, -1, 0, 0, NULL }, // pt_grav
+	{ 0, 0, -1, 0, 0, NULL }, // pt_slowgrav
+	{ 0, 0, 1, 5, 6, ramp3 }, // pt_fire
+	{ 4, 4, -1, 10, 8, ramp1 }, // pt_explode
+	{ -1, -1, -1, 15, 8, ramp2 }, // pt_explode2
+	{ 4, 4, -1, 0, 0, NULL }, // pt_blob
+	{ -4, 0, -1, 0, 0, NULL }, // pt_blob2
+};
+
+/* carves all the arrays out of one block, keeping each one 16 byte aligned */
+static void CL_SetupParticles(particles_t *pool, byte *base, int max)
+{
+	vec_t **floats[] = {
+		&pool->org[0], &pool->org[1], &pool->org[2],
+		&pool->vel[0], &pool->vel[1], &pool->vel[2],
+		&pool->die, &pool->ramp,
+		&pool->accel_xy, &pool->accel_z, &pool->gravity, &pool->rampspeed,
+	};
+
+	pool->count = 0;
+	pool->max = max;
+
+	for (size_t i = 0; i < ARRAY_SIZE(floats); i++, base += max * sizeof(vec_t))
+		*floats[i] = (vec_t *) base;
+	pool->color = base;
+	pool->type = base + max;
+}
+
+static size_t CL_ParticlesSize(int max)
+{
+	return max * (12 * sizeof(vec_t) + 2);
+}
+
+static void CL_SetParticleType(particles_t *pool, int p, ptype_t type)
+{
+	const ptypeinfo_t *info = &ptypeinfo[type];
+
+	pool->type[p] = type;
+	pool->accel_xy[p] = info->accel_xy;
+	pool->accel_z[p] = info->accel_z;
+	pool->gravity[p] = info->gravity;
+	pool->rampspeed[p] = info->rampspeed;
+}
+
+static int CL_AllocParticle(particles_t *pool, ptype_t type)
+{
+	if (pool->count == pool->max)
+		return -1;
 
-	particle_t *p = free_particles;
-	free_particles = p->next;
-	p->next = active_particles;
-	active_particles = p;
+	int p = pool->count++;
+	for (int j = 0; j < 3; j++)
+	{
+		pool->org[j][p] = 0;
+		pool->vel[j][p] = 0;
+	}
+	pool->ramp[p] = 0;
+	CL_SetParticleType(pool, p, type);
 
 	return p;
 }
 
+static int CL_GetParticle(ptype_t type)
+{
+	return CL_AllocParticle(&cl_particles, type);
+}
+
+static void CL_MoveParticle(particles_t *pool, int to, int from)
+{
+	for (int j = 0; j < 3; j++)
+	{
+		pool->org[j][to] = pool->org[j][from];
+		pool->vel[j][to] = pool->vel[j][from];
+	}
+	pool->color[to] = pool->color[from];
+	pool->die[to] = pool->die[from];
+	pool->ramp[to] = pool->ramp[from];
+	pool->accel_xy[to] = pool->accel_xy[from];
+	pool->accel_z[to] = pool->accel_z[from];
+	pool->gravity[to] = pool->gravity[from];
+	pool->rampspeed[to] = pool->rampspeed[from];
+	pool->type[to] = pool->type[from];
+}
+
 static void CL_ReadPointFile_f(void)
 {
 	FILE *f;
@@ -68,18 +148,17 @@ static void CL_ReadPointFile_f(void)
 	int c = 0;
 	while (fscanf(f, "%f %f %f\n", &org[0], &org[1], &org[2]) == 3)
 	{
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle(pt_static)) < 0)
 		{
 			Con_Printf("Not enough free particles\n");
 			break;
 		}
 
-		p->die = 99999;
-		p->color = (~(c++)) & 15;
-		p->type = pt_static;
-		VectorCopy(vec3_origin, p->vel);
-		VectorCopy(org, p->org);
+		cl_particles.die[p] = 99999;
+		cl_particles.color[p] = (~(c++)) & 15;
+		for (int j = 0; j < 3; j++)
+			cl_particles.org[j][p] = org[j];
 	}
 
 	COM_CloseFile(f);
@@ -109,28 +188,21 @@ void CL_EntityParticles(entity_t *ent)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle(pt_explode)) < 0)
 			return;
 
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
+		cl_particles.die[p] = cl.time + 0.01;
+		cl_particles.color[p] = 0x6f;
 
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0] * dist + forward[0] * beamlength;
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1] * dist + forward[1] * beamlength;
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2] * dist + forward[2] * beamlength;
+		for (int j = 0; j < 3; j++)
+			cl_particles.org[j][p] = ent->origin[j] + r_avertexnormals[i][j] * dist + forward[j] * beamlength;
 	}
 }
 
 void CL_ClearParticles(void)
 {
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (int i = 0; i < numparticles; i++)
-		particles[i].next = &particles[i + 1];
-	particles[numparticles - 1].next = NULL;
+	cl_particles.count = 0;
 }
 
 /* Parse an effect out of the server message */
@@ -152,57 +224,48 @@ void CL_ParseParticleEffect(void)
 	CL_RunParticleEffect(org, dir, color, count);
 }
 
-void CL_ParticleExplosion(vec3_t org)
+static void CL_ExplosionParticles(particles_t *pool, vec3_t org, int count)
 {
-	for (int i = 0; i < 1024; i++)
+	for (int i = 0; i < count; i++)
 	{
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_AllocParticle(pool, (i & 1) ? pt_explode : pt_explode2)) < 0)
 			return;
 
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = rand() & 3;
-		if (i & 1)
-		{
-			p->type = pt_explode;
-			for (int j = 0; j < 3; j++)
-			{
-				p->org[j] = org[j] + ((rand() % 32) - 16);
-				p->vel[j] = (rand() % 512) - 256;
-			}
-		}
-		else
+		pool->die[p] = cl.time + 5;
+		pool->color[p] = ramp1[0];
+		pool->ramp[p] = rand() & 3;
+		for (int j = 0; j < 3; j++)
 		{
-			p->type = pt_explode2;
-			for (int j = 0; j < 3; j++)
-			{
-				p->org[j] = org[j] + ((rand() % 32) - 16);
-				p->vel[j] = (rand() % 512) - 256;
-			}
+			pool->org[j][p] = org[j] + ((rand() % 32) - 16);
+			pool->vel[j][p] = (rand() % 512) - 256;
 		}
 	}
 }
 
+void CL_ParticleExplosion(vec3_t org)
+{
+	CL_ExplosionParticles(&cl_particles, org, 1024);
+}
+
 void CL_ParticleExplosion2(vec3_t org, int colorStart, int colorLength)
 {
 	int colorMod = 0;
 
 	for (int i = 0; i < 512; i++)
 	{
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle(pt_blob)) < 0)
 			return;
 
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
+		cl_particles.die[p] = cl.time + 0.3;
+		cl_particles.color[p] = colorStart + (colorMod % colorLength);
 		colorMod++;
-		p->type = pt_blob;
 
 		for (int j = 0; j < 3; j++)
 		{
-			p->org[j] = org[j] + ((rand() % 32) - 16);
-			p->vel[j] = (rand() % 512) - 256;
+			cl_particles.org[j][p] = org[j] + ((rand() % 32) - 16);
+			cl_particles.vel[j][p] = (rand() % 512) - 256;
 		}
 	}
 }
@@ -211,78 +274,46 @@ void CL_BlobExplosion(vec3_t org)
 {
 	for (int i = 0; i < 1024; i++)
 	{
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle((i & 1) ? pt_blob : pt_blob2)) < 0)
 			return;
 
-		p->die = cl.time + 1 + (rand() & 8) * 0.05;
+		cl_particles.die[p] = cl.time + 1 + (rand() & 8) * 0.05;
 
 		if (i & 1)
-		{
-			p->type = pt_blob;
-			p->color = 66 + rand() % 6;
-			for (int j = 0; j < 3; j++)
-			{
-				p->org[j] = org[j] + ((rand() % 32) - 16);
-				p->vel[j] = (rand() % 512) - 256;
-			}
-		}
+			cl_particles.color[p] = 66 + rand() % 6;
 		else
+			cl_particles.color[p] = 150 + rand() % 6;
+
+		for (int j = 0; j < 3; j++)
 		{
-			p->type = pt_blob2;
-			p->color = 150 + rand() % 6;
-			for (int j = 0; j < 3; j++)
-			{
-				p->org[j] = org[j] + ((rand() % 32) - 16);
-				p->vel[j] = (rand() % 512) - 256;
-			}
+			cl_particles.org[j][p] = org[j] + ((rand() % 32) - 16);
+			cl_particles.vel[j][p] = (rand() % 512) - 256;
 		}
 	}
 }
 
 void CL_RunParticleEffect(vec3_t org, vec3_t dir, int color, int count)
 {
+	if (count == 1024) // rocket explosion
+	{
+		CL_ExplosionParticles(&cl_particles, org, count);
+		return;
+	}
+
 	for (int i = 0; i < count; i++)
 	{
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle(pt_slowgrav)) < 0)
 			return;
 
-		if (count == 1024) // rocket explosion
-		{
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = rand() & 3;
-			if (i & 1)
-			{
-				p->type = pt_explode;
-				for (int j = 0; j < 3; j++)
-				{
-					p->org[j] = org[j] + ((rand() % 32) - 16);
-					p->vel[j] = (rand() % 512) - 256;
-				}
-			}
-			else
-			{
-				p->type = pt_explode2;
-				for (int j = 0; j < 3; j++)
-				{
-					p->org[j] = org[j] + ((rand() % 32) - 16);
-					p->vel[j] = (rand() % 512) - 256;
-				}
-			}
-		}
-		else
-		{
-			p->die = cl.time + 0.1 * (rand() % 5);
-			p->color = (color & ~7) + (rand() & 7);
-			p->type = pt_slowgrav;
+		cl_particles.die[p] = cl.time + 0.1 * (rand() % 5);
+		cl_particles.color[p] = (color & ~7) + (rand() & 7);
 
-			for (int j = 0; j < 3; j++)
-			{
-				p->org[j] = org[j] + ((rand() & 15) - 8);
-				p->vel[j] = dir[j] * 15;
-			}
+		for (int j = 0; j < 3; j++)
+		{
+			cl_particles.org[j][p] = org[j] + ((rand() & 15) - 8);
+			cl_particles.vel[j][p] = dir[j] * 15;
 		}
 	}
 }
@@ -295,26 +326,26 @@ void CL_LavaSplash(vec3_t org)
 		{
 			for (int k = 0; k < 1; k++)
 			{
-				particle_t *p;
-				if (!(p = CL_GetParticle()))
+				int p;
+				if ((p = CL_GetParticle(pt_slowgrav)) < 0)
 					return;
 
-				p->die = cl.time + 2 + (rand() & 31) * 0.02;
-				p->color = 224 + (rand() & 7);
-				p->type = pt_slowgrav;
+				cl_particles.die[p] = cl.time + 2 + (rand() & 31) * 0.02;
+				cl_particles.color[p] = 224 + (rand() & 7);
 
 				vec3_t dir;
 				dir[0] = j * 8 + (rand() & 7);
 				dir[1] = i * 8 + (rand() & 7);
 				dir[2] = 256;
 
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (rand() & 63);
+				cl_particles.org[0][p] = org[0] + dir[0];
+				cl_particles.org[1][p] = org[1] + dir[1];
+				cl_particles.org[2][p] = org[2] + (rand() & 63);
 
 				VectorNormalize(dir);
 				float vel = 50 + (rand() & 63);
-				VectorScale(dir, vel, p->vel);
+				for (int l = 0; l < 3; l++)
+					cl_particles.vel[l][p] = dir[l] * vel;
 			}
 		}
 	}
@@ -328,26 +359,26 @@ void CL_TeleportSplash(vec3_t org)
 		{
 			for (int k = -24; k < 32; k += 4)
 			{
-				particle_t *p;
-				if (!(p = CL_GetParticle()))
+				int p;
+				if ((p = CL_GetParticle(pt_slowgrav)) < 0)
 					return;
 
-				p->die = cl.time + 0.2 + (rand() & 7) * 0.02;
-				p->color = 7 + (rand() & 7);
-				p->type = pt_slowgrav;
+				cl_particles.die[p] = cl.time + 0.2 + (rand() & 7) * 0.02;
+				cl_particles.color[p] = 7 + (rand() & 7);
 
 				vec3_t dir;
 				dir[0] = j * 8;
 				dir[1] = i * 8;
 				dir[2] = k * 8;
 
-				p->org[0] = org[0] + i + (rand() & 3);
-				p->org[1] = org[1] + j + (rand() & 3);
-				p->org[2] = org[2] + k + (rand() & 3);
+				cl_particles.org[0][p] = org[0] + i + (rand() & 3);
+				cl_particles.org[1][p] = org[1] + j + (rand() & 3);
+				cl_particles.org[2][p] = org[2] + k + (rand() & 3);
 
 				VectorNormalize(dir);
 				float vel = 50 + (rand() & 63);
-				VectorScale(dir, vel, p->vel);
+				for (int l = 0; l < 3; l++)
+					cl_particles.vel[l][p] = dir[l] * vel;
 			}
 		}
 	}
@@ -365,72 +396,70 @@ void CL_RocketTrail(vec3_t start, vec3_t end, int type)
 	{
 		len -= 3;
 
-		particle_t *p;
-		if (!(p = CL_GetParticle()))
+		int p;
+		if ((p = CL_GetParticle(pt_static)) < 0)
 			return;
 
-		VectorCopy(vec3_origin, p->vel);
-		p->die = cl.time + 2;
+		cl_particles.die[p] = cl.time + 2;
 
 		switch (type)
 		{
 		case GRENADE_TRAIL:
-			p->ramp = (rand() & 3) + 2;
-			p->color = ramp3[(int) p->ramp];
-			p->type = pt_fire;
+			cl_particles.ramp[p] = (rand() & 3) + 2;
+			cl_particles.color[p] = ramp3[(int) cl_particles.ramp[p]];
+			CL_SetParticleType(&cl_particles, p, pt_fire);
 			for (int j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((rand() % 6) - 3);
+				cl_particles.org[j][p] = start[j] + ((rand() % 6) - 3);
 			break;
 
 		case BLOOD_TRAIL:
-			p->type = pt_grav;
-			p->color = 67 + (rand() & 3);
+			CL_SetParticleType(&cl_particles, p, pt_grav);
+			cl_particles.color[p] = 67 + (rand() & 3);
 			for (int j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((rand() % 6) - 3);
+				cl_particles.org[j][p] = start[j] + ((rand() % 6) - 3);
 			break;
 
 		case SLIGHT_BLOOD_TRAIL:
-			p->type = pt_grav;
-			p->color = 67 + (rand() & 3);
+			CL_SetParticleType(&cl_particles, p, pt_grav);
+			cl_particles.color[p] = 67 + (rand() & 3);
 			for (int j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((rand() % 6) - 3);
+				cl_particles.org[j][p] = start[j] + ((rand() % 6) - 3);
 			len -= 3;
 			break;
 
 		case TRACER1_TRAIL:
 		case TRACER2_TRAIL:
-			p->die = cl.time + 0.5;
-			p->type = pt_static;
-			p->color = (type == TRACER1_TRAIL) ? 52 + ((tracercount & 4) << 1) : 230 + ((tracercount & 4) << 1);
+			cl_particles.die[p] = cl.time + 0.5;
+			cl_particles.color[p] = (type == TRACER1_TRAIL) ? 52 + ((tracercount & 4) << 1) : 230 + ((tracercount & 4) << 1);
 			tracercount++;
 
-			VectorCopy(start, p->org) ;
+			for (int j = 0; j < 3; j++)
+				cl_particles.org[j][p] = start[j];
 			if (tracercount & 1)
 			{
-				p->vel[0] = 30 * vec[1];
-				p->vel[1] = 30 * -vec[0];
+				cl_particles.vel[0][p] = 30 * vec[1];
+				cl_particles.vel[1][p] = 30 * -vec[0];
 			}
 			else
 			{
-				p->vel[0] = 30 * -vec[1];
-				p->vel[1] = 30 * vec[0];
+				cl_particles.vel[0][p] = 30 * -vec[1];
+				cl_particles.vel[1][p] = 30 * vec[0];
 			}
 			break;
 
 		case VOOR_TRAIL:
-			p->color = 9 * 16 + 8 + (rand() & 3);
-			p->type = pt_static;
-			p->die = cl.time + 0.3;
+			cl_particles.color[p] = 9 * 16 + 8 + (rand() & 3);
+			cl_particles.die[p] = cl.time + 0.3;
 			for (int j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((rand() & 15) - 8);
+				cl_particles.org[j][p] = start[j] + ((rand() & 15) - 8);
 			break;
 
 		case ROCKET_TRAIL:
-			p->ramp = (rand() & 3);
-			p->color = ramp3[(int) p->ramp];
-			p->type = pt_fire;
+			cl_particles.ramp[p] = (rand() & 3);
+			cl_particles.color[p] = ramp3[(int) cl_particles.ramp[p]];
+			CL_SetParticleType(&cl_particles, p, pt_fire);
 			for (int j = 0; j < 3; j++)
-				p->org[j] = start[j] + ((rand() % 6) - 3);
+				cl_particles.org[j][p] = start[j] + ((rand() % 6) - 3);
 			break;
 		}
 
@@ -438,94 +467,179 @@ void CL_RocketTrail(vec3_t start, vec3_t end, int type)
 	}
 }
 
-void CL_RunParticles(void)
+/* moves every particle one frame along, four at a time */
+static void CL_IntegrateParticles(particles_t *pool, float frametime, float grav)
 {
-	extern cvar_t sv_gravity;
+	vec_t *org_x = pool->org[0], *org_y = pool->org[1], *org_z = pool->org[2];
+	vec_t *vel_x = pool->vel[0], *vel_y = pool->vel[1], *vel_z = pool->vel[2];
+	int count = pool->count;
+	int i = 0;
+
+	vec4f_t ft = V4_Set(frametime);
+	vec4f_t g = V4_Set(grav);
+	for (; i + 4 <= count; i += 4)
+	{
+		vec4f_t vx = V4_Load(vel_x + i);
+		vec4f_t vy = V4_Load(vel_y + i);
+		vec4f_t vz = V4_Load(vel_z + i);
 
-	float frametime = cl.time - cl.oldtime;
-	float time3 = frametime * 15;
-	float time2 = frametime * 10; // 15;
-	float time1 = frametime * 5;
-	float grav = frametime * sv_gravity.value * 0.05;
-	float dvel = 4 * frametime;
+		V4_Store(org_x + i, V4_Load(org_x + i) + vx * ft);
+		V4_Store(org_y + i, V4_Load(org_y + i) + vy * ft);
+		V4_Store(org_z + i, V4_Load(org_z + i) + vz * ft);
 
-	// free dead particles
-	while (active_particles && active_particles->die < cl.time)
+		vec4f_t axy = V4_Load(pool->accel_xy + i) * ft;
+		vec4f_t az = V4_Load(pool->accel_z + i) * ft;
+		V4_Store(vel_x + i, vx + vx * axy);
+		V4_Store(vel_y + i, vy + vy * axy);
+		V4_Store(vel_z + i, vz + vz * az + V4_Load(pool->gravity + i) * g);
+
+		V4_Store(pool->ramp + i, V4_Load(pool->ramp + i) + V4_Load(pool->rampspeed + i) * ft);
+	}
+
+	for (; i < count; i++)
 	{
-		particle_t *kill = active_particles;
-		active_particles = active_particles->next;
-		kill->next = free_particles;
-		free_particles = kill;
+		org_x[i] += vel_x[i] * frametime;
+		org_y[i] += vel_y[i] * frametime;
+		org_z[i] += vel_z[i] * frametime;
+
+		vel_x[i] += vel_x[i] * pool->accel_xy[i] * frametime;
+		vel_y[i] += vel_y[i] * pool->accel_xy[i] * frametime;
+		vel_z[i] += vel_z[i] * pool->accel_z[i] * frametime + pool->gravity[i] * grav;
+
+		pool->ramp[i] += pool->rampspeed[i] * frametime;
 	}
 
-	for (particle_t *p = active_particles; p; p = p->next)
+	// step the color ramps, killing particles that ran off the end
+	for (i = 0; i < count; i++)
 	{
-		// free dead particles
-		while (p->next && p->next->die < cl.time)
+		if (!pool->rampspeed[i])
+			continue;
+
+		const ptypeinfo_t *info = &ptypeinfo[pool->type[i]];
+		if (pool->ramp[i] >= info->ramplimit)
+			pool->die[i] = -1;
+		else
+			pool->color[i] = info->ramp[(int) pool->ramp[i]];
+	}
+}
+
+/* frees dead particles by swapping the last live one into their slot */
+static void CL_CompactParticles(particles_t *pool, float time)
+{
+	for (int i = 0; i < pool->count; )
+	{
+		if (pool->die[i] >= time)
 		{
-			particle_t *kill = p->next;
-			p->next = p->next->next;
-			kill->next = free_particles;
-			free_particles = kill;
+			i++;
+			continue;
 		}
 
-		p->org[0] += p->vel[0] * frametime;
-		p->org[1] += p->vel[1] * frametime;
-		p->org[2] += p->vel[2] * frametime;
+		pool->count--;
+		if (i != pool->count)
+			CL_MoveParticle(pool, i, pool->count);
+	}
+}
 
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int) p->ramp];
-			p->vel[2] += grav;
-			break;
+static void CL_UpdateParticles(particles_t *pool, float time, float frametime)
+{
+	extern cvar_t sv_gravity;
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int) p->ramp];
-			for (int i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	CL_CompactParticles(pool, time);
+	CL_IntegrateParticles(pool, frametime, frametime * sv_gravity.value * 0.05);
+}
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int) p->ramp];
-			for (int i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
-			break;
+void CL_RunParticles(void)
+{
+	CL_UpdateParticles(&cl_particles, cl.time, cl.time - cl.oldtime);
+}
 
-		case pt_blob:
-			for (int i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+/* writes one triangle per particle, returns the number of vertices */
+int CL_BuildParticleVerts(const particles_t *pool, int first, int count, particlevert_t *verts, const vec3_t origin,
+		const vec3_t forward, const vec3_t up, const vec3_t right, const unsigned int *palette, byte alpha)
+{
+	particlevert_t *v = verts;
 
-		case pt_blob2:
-			for (int i = 0; i < 2; i++)
-				p->vel[i] -= p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	for (int i = first; i < first + count; i++, v += 3)
+	{
+		vec3_t org = { pool->org[0][i], pool->org[1][i], pool->org[2][i] };
+
+		// hack a scale up to keep particles from disappearing
+		float scale = (org[0] - origin[0]) * forward[0] +
+			(org[1] - origin[1]) * forward[1] +
+			(org[2] - origin[2]) * forward[2];
+		if (scale < 20)
+			scale = 1;
+		else
+			scale = 1 + scale * 0.004;
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
+		const byte *rgb = (const byte *) &palette[pool->color[i]];
+		for (int j = 0; j < 3; j++)
+		{
+			v[0].xyz[j] = org[j];
+			v[1].xyz[j] = org[j] + up[j] * scale;
+			v[2].xyz[j] = org[j] + right[j] * scale;
+			v[0].color[j] = v[1].color[j] = v[2].color[j] = rgb[j];
 		}
+		v[0].color[3] = v[1].color[3] = v[2].color[3] = alpha;
+
+		v[0].st[0] = 0; v[0].st[1] = 0;
+		v[1].st[0] = 1; v[1].st[1] = 0;
+		v[2].st[0] = 0; v[2].st[1] = 1;
 	}
+
+	return v - verts;
+}
+
+/* spawns explosions into a scratch pool and times the update, no video needed */
+static void CL_ParticleBench_f(void)
+{
+	int count = 100000;
+	int frames = 100;
+
+	if (Cmd_Argc() > 1)
+		count = atoi(Cmd_Argv(1));
+	if (Cmd_Argc() > 2)
+		frames = atoi(Cmd_Argv(2));
+	count = (max(count, 4) + 3) & ~3;
+	frames = max(frames, 1);
+
+	particles_t pool;
+	byte *base = (byte *) Q_malloc(CL_ParticlesSize(count));
+	particlevert_t *verts = (particlevert_t *) Q_malloc(count * 3 * sizeof(particlevert_t));
+	unsigned int palette[256];
+	for (int i = 0; i < 256; i++)
+		palette[i] = i * 0x010101;
+	CL_SetupParticles(&pool, base, count);
+
+	vec3_t org = { 0, 0, 0 };
+	while (pool.count < pool.max)
+		CL_ExplosionParticles(&pool, org, 1024);
+
+	vec3_t forward = { 1, 0, 0 };
+	vec3_t up = { 0, 0, 1.5 };
+	vec3_t right = { 0, -1.5, 0 };
+	double update_time = 0, build_time = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		double start = Sys_DoubleTime();
+		CL_UpdateParticles(&pool, 0, 1.0 / 72);
+		double mid = Sys_DoubleTime();
+		CL_BuildParticleVerts(&pool, 0, pool.count, verts, org, forward, up, right, palette, 255);
+		double stop = Sys_DoubleTime();
+
+		update_time += mid - start;
+		build_time += stop - mid;
+
+		// the ramps kill off the explosions, respawn to keep the count up
+		while (pool.count < pool.max)
+			CL_ExplosionParticles(&pool, org, 1024);
+	}
+
+	Con_Printf("%i particles, %i frames: %.3f ms update, %.3f ms vertex build per frame\n",
+		   pool.max, frames, update_time * 1000 / frames, build_time * 1000 / frames);
+
+	free(verts);
+	free(base);
 }
 
 void CL_InitParticles(void)
@@ -537,6 +651,7 @@ void CL_InitParticles(void)
 		for (int j = 0; j < 3; j++)
 			avelocities[i][j] = (rand() & 255) * 0.01;
 
+	int numparticles;
 	if ((i = COM_CheckParm("-particles")) && i + 1 < com_argc)
 	{
 		numparticles = atoi(com_argv[i + 1]);
@@ -546,8 +661,11 @@ void CL_InitParticles(void)
 	{
 		numparticles = DEFAULT_NUM_PARTICLES;
 	}
+	numparticles = (numparticles + 3) & ~3;
 
-	particles = (particle_t *) Hunk_AllocName(numparticles * sizeof(particle_t), "particles");
+	byte *base = (byte *) Hunk_AllocName(CL_ParticlesSize(numparticles), "particles");
+	CL_SetupParticles(&cl_particles, base, numparticles);
 
 	Cmd_AddCommand("pointfile", CL_ReadPointFile_f);
+	Cmd_AddCommand("particlebench", CL_ParticleBench_f);
 }
@@ -258,18 +258,37 @@ typedef enum
 	pt_blob2,
 } ptype_t;
 
-typedef struct particle_s
+/*
+ * Particles are kept as a structure of arrays with the live ones packed at
+ * the front, so the integrator can run down each array four at a time and
+ * dead particles are removed by swapping in the last one.
+ */
+typedef struct
 {
+	int count; // live particles
+	int max;
+
 // driver-usable fields
-	vec3_t org;
-	float color;
+	vec_t *org[3];
+	byte *color;
+
 // drivers never touch the following fields
-	struct particle_s *next;
-	vec3_t vel;
-	float ramp;
-	float die;
-	ptype_t type;
-} particle_t;
+	vec_t *vel[3];
+	float *die;
+	float *ramp;
+	float *accel_xy; // fraction of velocity gained per second
+	float *accel_z;
+	float *gravity; // in units of sv_gravity * 0.05
+	float *rampspeed;
+	byte *type;
+} particles_t;
+
+typedef struct
+{
+	vec3_t xyz;
+	float st[2];
+	byte color[4];
+} particlevert_t;
 
 //
 // cvars
@@ -455,6 +474,10 @@ void CL_LavaSplash(vec3_t org);
 void CL_TeleportSplash(vec3_t org);
 void CL_RocketTrail(vec3_t start, vec3_t end, int type);
 void CL_RunParticles(void);
+int CL_BuildParticleVerts(const particles_t *pool, int first, int count, particlevert_t *verts, const vec3_t origin,
+		const vec3_t forward, const vec3_t up, const vec3_t right, const unsigned int *palette, byte alpha);
 void CL_InitParticles(void);
 
+extern particles_t cl_particles;
+
 #endif	/* __CLIENT_H */
@@ -26,19 +26,100 @@ const float r_avertexnormal_dots[SHADEDOT_QUANT][256] = {
 	#include "anorm_dots.h"
 };
 
+/*
+ * Each model keeps its front and back texture coordinates followed by the
+ * positions of every pose in one static vertex buffer, and its triangles in
+ * an index buffer, so drawing a frame only moves the vertex pointer. Alias
+ * models stay loaded once loaded, so the buffers are never freed.
+ */
+
+static alias_model_t *alias_bound; // model whose buffers are bound
+
+static void GL_BuildAliasVBO(alias_model_t *aliasmodel)
+{
+	size_t stsize = aliasmodel->numverts * sizeof(mstvert_t);
+	size_t posesize = aliasmodel->numverts * sizeof(vec3_t);
+	size_t numposes = 0;
+
+	for (size_t i = 0; i < aliasmodel->numframes; i++)
+		numposes += aliasmodel->frames[i].numposes;
+
+	size_t size = 2 * stsize + numposes * posesize;
+	byte *data = (byte *) Q_malloc(size);
+	memcpy(data, aliasmodel->frontstverts, stsize);
+	memcpy(data + stsize, aliasmodel->backstverts, stsize);
+
+	size_t offset = 2 * stsize;
+	for (size_t i = 0; i < aliasmodel->numframes; i++)
+	{
+		for (size_t j = 0; j < aliasmodel->frames[i].numposes; j++)
+		{
+			mpose_t *pose = &aliasmodel->frames[i].poses[j];
+			vec_t *out = (vec_t *) (data + offset);
+
+			for (size_t k = 0; k < aliasmodel->numverts; k++, out += 3)
+				VectorCopy(pose->posevirts[k].v, out);
+
+			pose->vbo_offset = offset;
+			offset += posesize;
+		}
+	}
+
+	glGenBuffers(1, &aliasmodel->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, aliasmodel->vbo);
+	glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &aliasmodel->ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, aliasmodel->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, aliasmodel->numtris * sizeof(mtriangle_t), aliasmodel->triangles, GL_STATIC_DRAW);
+
+	free(data);
+}
+
+/* Binds the buffers of aliasmodel unless the last model drawn was the same */
+static void GL_BindAliasModel(alias_model_t *aliasmodel)
+{
+	if (alias_bound == aliasmodel)
+		return;
+
+	if (!aliasmodel->vbo)
+	{
+		GL_BuildAliasVBO(aliasmodel);
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, aliasmodel->vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, aliasmodel->ibo);
+	}
+	alias_bound = aliasmodel;
+	c_buffer_binds++;
+}
+
+/* Puts back client side arrays once a run of alias models is drawn */
+void R_EndAliasModels(void)
+{
+	if (!alias_bound)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	alias_bound = NULL;
+}
+
 static void GL_DrawAliasFrame(alias_model_t *aliasmodel, size_t frame, size_t pose, float light, float alpha)
 {
 	if (alpha < 1.0f)
 		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	mpose_t *ppose = &aliasmodel->frames[frame].poses[pose];
-	glVertexPointer(3, GL_FLOAT, sizeof(ppose->posevirts[0]), &ppose->posevirts[0].v);
-//	glNormalPointer(GL_FLOAT, sizeof(ppose->posevirts[0]), &ppose->posevirts[0].normal);
+	glVertexPointer(3, GL_FLOAT, 0, (void *) ppose->vbo_offset);
 
-	glTexCoordPointer(2, GL_FLOAT, sizeof(aliasmodel->frontstverts[0]), &aliasmodel->frontstverts->s);
-	glDrawElements(GL_TRIANGLES, aliasmodel->backstart * 3, GL_UNSIGNED_SHORT, aliasmodel->triangles);
-	glTexCoordPointer(2, GL_FLOAT, sizeof(aliasmodel->backstverts[0]), &aliasmodel->backstverts->s);
-	glDrawElements(GL_TRIANGLES, (aliasmodel->numtris - aliasmodel->backstart) * 3, GL_UNSIGNED_SHORT, (aliasmodel->triangles + aliasmodel->backstart));
+	glTexCoordPointer(2, GL_FLOAT, 0, (void *) 0);
+	glDrawElements(GL_TRIANGLES, aliasmodel->backstart * 3, GL_UNSIGNED_SHORT, (void *) 0);
+	c_draw_calls++;
+	glTexCoordPointer(2, GL_FLOAT, 0, (void *) (aliasmodel->numverts * sizeof(mstvert_t)));
+	glDrawElements(GL_TRIANGLES, (aliasmodel->numtris - aliasmodel->backstart) * 3, GL_UNSIGNED_SHORT, (void *) (aliasmodel->backstart * sizeof(mtriangle_t)));
+	c_draw_calls++;
 
 	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 
@@ -73,8 +154,12 @@ static void GL_DrawAliasShadow(entity_t *ent, alias_model_t *aliasmodel, size_t
 	glDisable(GL_TEXTURE_2D);
 	glColor4f(0.0f, 0.0f, 0.0f, r_shadows.value);
 
+	// the positions come from client memory, the triangles still from the index buffer
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glVertexPointer(3, GL_FLOAT, sizeof(*shadowverts), shadowverts);
-	glDrawElements(GL_TRIANGLES, aliasmodel->numtris * 3, GL_UNSIGNED_SHORT, aliasmodel->triangles);
+	glDrawElements(GL_TRIANGLES, aliasmodel->numtris * 3, GL_UNSIGNED_SHORT, (void *) 0);
+	c_draw_calls++;
+	glBindBuffer(GL_ARRAY_BUFFER, aliasmodel->vbo);
 
 	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 	glEnable(GL_TEXTURE_2D);
@@ -103,6 +188,24 @@ static size_t R_GetAliasPose(alias_model_t *aliasmodel, size_t frame)
 	return pframe->current_pose;
 }
 
+/* Returns the skin ent is drawn with this frame, NULL for the checkerboard */
+gltexture_t *R_AliasSkin(entity_t *ent, gltexture_t **fullbright)
+{
+	alias_model_t *aliasmodel = ent->model->aliasmodel;
+	int anim = (int) (cl.time * 10) & 3;
+
+	if (ent->skinnum < 0 || ent->skinnum >= aliasmodel->numskins)
+	{
+		if (fullbright)
+			*fullbright = NULL;
+		return NULL;
+	}
+
+	if (fullbright)
+		*fullbright = aliasmodel->gl_fbtexturenum[ent->skinnum][anim];
+	return aliasmodel->gl_texturenum[ent->skinnum][anim];
+}
+
 void R_DrawAliasModel(entity_t *ent)
 {
 	bool isPlayer = ent > cl_entities &&
@@ -111,8 +214,7 @@ void R_DrawAliasModel(entity_t *ent)
 	gltexture_t *tx;
 	gltexture_t *fb;
 
-	if (R_CullForEntity(ent))
-		return;
+	// culled by the entity queue
 
 	// get lighting information
 	ambientlight = shadelight = R_LightPoint(ent->origin);
@@ -175,19 +277,9 @@ void R_DrawAliasModel(entity_t *ent)
 
 	glLoadMatrixf(modelViewMatrix.get());
 
-	int anim = (int) (cl.time * 10) & 3;
-	if ((ent->skinnum < 0) ||
-	    (ent->skinnum >= aliasmodel->numskins))
-	{
+	tx = R_AliasSkin(ent, &fb);
+	if (ent->skinnum < 0 || ent->skinnum >= aliasmodel->numskins)
 		Con_DPrintf("no such skin # %d for '%s'\n", ent->skinnum, ent->model->name);
-		tx = 0; // NULL will give the checkerboard texture
-		fb = 0;
-	}
-	else
-	{
-		tx = aliasmodel->gl_texturenum[ent->skinnum][anim];
-		fb = aliasmodel->gl_fbtexturenum[ent->skinnum][anim];
-	}
 
 	GL_Bind(tx);
 
@@ -224,6 +316,7 @@ void R_DrawAliasModel(entity_t *ent)
 	float light = 0.0f;
 	glColor4f(light, light, light, alpha);
 
+	GL_BindAliasModel(aliasmodel);
 	GL_DrawAliasFrame(aliasmodel, frame, pose, light, alpha);
 
 	if (fb)
@@ -98,7 +98,7 @@ void Scrap_Upload(void)
 	{
 		char name[8];
 		sprintf(name, "scrap%i", i);
-		scrap_textures[i] = TexMgr_LoadImage(name, BLOCK_WIDTH, BLOCK_HEIGHT, SRC_INDEXED, scrap_texels[i], TEX_ALPHA | TEX_OVERWRITE | TEX_NOPICMIP);
+		scrap_textures[i] = TexMgr_LoadImage(name, BLOCK_WIDTH, BLOCK_HEIGHT, SRC_INDEXED, scrap_texels[i], NULL, 0, TEX_ALPHA | TEX_OVERWRITE | TEX_NOPICMIP);
 	}
 }
 
@@ -140,7 +140,8 @@ qpic_t *Draw_PicFromWad(const char *name)
 		char texturename[64];
 		snprintf(texturename, sizeof(texturename), "%s", name);
 
-		gl->gltexture = TexMgr_LoadImage(texturename, p->width, p->height, SRC_INDEXED, p->data, TEX_ALPHA | TEX_PAD | TEX_NOPICMIP);
+		src_offset_t offset = (src_offset_t) p->data - (src_offset_t) wad_base;
+		gl->gltexture = TexMgr_LoadImage(texturename, p->width, p->height, SRC_INDEXED, p->data, "gfx.wad", offset, TEX_ALPHA | TEX_PAD | TEX_NOPICMIP);
 		gl->sl = 0;
 		gl->sh = (float) p->width / (float) TexMgr_PadConditional(p->width);
 		gl->tl = 0;
@@ -174,7 +175,8 @@ qpic_t *Draw_CachePic(const char *path)
 	SwapPic(dat);
 
 	// FIXME: do we need to pad this image like above?
-	pic->gltexture = TexMgr_LoadImage("", dat->width, dat->height, SRC_INDEXED, dat->data, TEX_ALPHA);
+	src_offset_t offset = (src_offset_t) dat->data - (src_offset_t) dat;
+	pic->gltexture = TexMgr_LoadImage("", dat->width, dat->height, SRC_INDEXED, dat->data, path, offset, TEX_ALPHA);
 	pic->sl = 0;
 	pic->sh = 1;
 	pic->tl = 0;
@@ -532,7 +534,7 @@ qpic_t *Draw_MakePic(const char *name, int width, int height, byte *data)
 
 	qpic_t *pic = (qpic_t *) Hunk_Alloc(sizeof(qpic_t));
 
-	pic->gltexture = TexMgr_LoadImage(name, width, height, SRC_INDEXED, data, flags);
+	pic->gltexture = TexMgr_LoadImage(name, width, height, SRC_INDEXED, data, NULL, 0, flags);
 	pic->width = (float) TexMgr_PadConditional(width);
 	pic->height = (float) TexMgr_PadConditional(height);
 	pic->sl = 0;
@@ -551,7 +553,7 @@ static void Load_CharSet(void)
 			draw_chars[i] = 255; // proper transparent color
 
 	// now turn them into textures
-	char_texture = TexMgr_LoadImage("charset", 128, 128, SRC_INDEXED, draw_chars, TEX_ALPHA | TEX_NOPICMIP);
+	char_texture = TexMgr_LoadImage("charset", 128, 128, SRC_INDEXED, draw_chars, NULL, 0, TEX_ALPHA | TEX_NOPICMIP);
 }
 
 void Draw_Init(void)
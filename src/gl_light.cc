@@ -14,25 +14,28 @@
 
 #include "quakedef.h"
 #include "glquake.h"
-
-#define	BLOCK_WIDTH     128
-#define	BLOCK_HEIGHT    128
+#include "atlas.h"
 
 #define	MAX_LIGHTMAPS   128
 
 typedef struct glRect_s
 {
-	unsigned char l, t, w, h;
+	unsigned short l, t, w, h;
 } glRect_t;
 
 gltexture_t *lightmap_textures[MAX_LIGHTMAPS];
 unsigned int blocklights[18 * 18];
 
-static int allocated[MAX_LIGHTMAPS][BLOCK_WIDTH];
+// size of every lightmap page, set from gl_lightmapsize when the lightmaps are built
+static int lightmap_width = 128, lightmap_height = 128;
+
+static atlas_t lightmap_atlas[MAX_LIGHTMAPS];
+static int lightmap_count;
+static double lightmap_buildtime;
 
 // the lightmap texture data needs to be kept in
 // main memory so texsubimage can update properly
-byte lightmaps[MAX_LIGHTMAPS * 4][BLOCK_WIDTH * BLOCK_HEIGHT];
+static byte *lightmaps[MAX_LIGHTMAPS];
 
 glpoly_t *lightmap_polys[MAX_LIGHTMAPS];
 bool lightmap_modified[MAX_LIGHTMAPS];
@@ -40,6 +43,10 @@ glRect_t lightmap_rectchange[MAX_LIGHTMAPS];
 
 int d_lightstylevalue[256]; // 8.8 fraction of base light value
 
+// lightmapped surfaces using each animated style, so a style change only visits its own surfaces
+static msurface_t **style_surfaces;
+static int style_firstsurface[MAX_LIGHTSTYLES + 1];
+
 int r_dlightframecount;
 
 extern cvar_t gl_overbright;
@@ -63,10 +70,10 @@ void R_UploadLightmap(int lmap)
 
 	glRect_t *theRect = &lightmap_rectchange[lmap];
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, theRect->t,
-			BLOCK_WIDTH, theRect->h, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-			((byte *)lightmaps) + (lmap * BLOCK_HEIGHT + theRect->t) * BLOCK_WIDTH);
-	theRect->l = BLOCK_WIDTH;
-	theRect->t = BLOCK_HEIGHT;
+			lightmap_width, theRect->h, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+			lightmaps[lmap] + theRect->t * lightmap_width);
+	theRect->l = lightmap_width;
+	theRect->t = lightmap_height;
 	theRect->h = 0;
 	theRect->w = 0;
 
@@ -123,10 +130,51 @@ static void R_AddDynamicLights(msurface_t *surf)
 	}
 }
 
+/* blocklights += lightmap * scale, four samples at a time */
+static void R_AccumulateLightMap(unsigned int *dest, const byte *lightmap, unsigned int scale, int size)
+{
+	int i;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		vec4b_t samples;
+		vec4u_t light;
+		memcpy(&samples, lightmap + i, sizeof(samples));
+		memcpy(&light, dest + i, sizeof(light));
+		light += __builtin_convertvector(samples, vec4u_t) * scale;
+		memcpy(dest + i, &light, sizeof(light));
+	}
+	for (; i < size; i++)
+		dest[i] += lightmap[i] * scale;
+}
+
+/* shifts down and clamps a row of blocklights to bytes */
+static void R_StoreLightMapRow(byte *dest, const unsigned int *light, int smax, int shift)
+{
+	int j;
+
+	for (j = 0; j + 4 <= smax; j += 4)
+	{
+		vec4u_t t;
+		memcpy(&t, light + j, sizeof(t));
+		t >>= shift;
+		vec4u_t over = (vec4u_t) (t > 255);
+		t = (t & ~over) | (over & 255);
+		vec4b_t out = __builtin_convertvector(t, vec4b_t);
+		memcpy(dest + j, &out, sizeof(out));
+	}
+	for (; j < smax; j++)
+	{
+		unsigned int t = light[j] >> shift;
+		dest[j] = t > 255 ? 255 : t;
+	}
+}
+
 /* Combine and scale multiple lightmaps into the 8.8 format in blocklights */
 void R_BuildLightMap(msurface_t *surf, byte *dest, int stride)
 {
 	surf->cached_dlight = (surf->dlightframe == r_framecount);
+	surf->lightstale = false;
 
 	int smax = (surf->extents[0] >> 4) + 1;
 	int tmax = (surf->extents[1] >> 4) + 1;
@@ -142,8 +190,7 @@ void R_BuildLightMap(msurface_t *surf, byte *dest, int stride)
 	}
 
 	// clear to no light
-	for (int i = 0; i < size; i++)
-		blocklights[i] = 0;
+	memset(blocklights, 0, size * sizeof(*blocklights));
 
 	// add all the lightmaps
 	if (lightmap)
@@ -151,8 +198,7 @@ void R_BuildLightMap(msurface_t *surf, byte *dest, int stride)
 		{
 			unsigned int scale = d_lightstylevalue[surf->styles[lmap]];
 			surf->cached_light[lmap] = scale; // 8.8 fraction
-			for (int i = 0; i < size; i++)
-				blocklights[i] += lightmap[i] * scale;
+			R_AccumulateLightMap(blocklights, lightmap, scale, size);
 			lightmap += size; // skip to next lightmap
 		}
 
@@ -162,20 +208,9 @@ void R_BuildLightMap(msurface_t *surf, byte *dest, int stride)
 
 	// bound, invert, and shift
 store:
+	int shift = gl_overbright.value ? 8 : 7;
 	for (int i = 0; i < tmax; i++)
-	{
-		for (int j = 0; j < smax; j++)
-		{
-			int t = blocklights[j + (i * smax)];
-			if (gl_overbright.value)
-				t >>= 8;
-			else
-				t >>= 7;
-			if (t > 255)
-				t = 255;
-			dest[j + (i * stride)] = t;
-		}
-	}
+		R_StoreLightMapRow(dest + i * stride, blocklights + i * smax, smax, shift);
 }
 
 void R_RenderDynamicLightmaps(msurface_t *fa)
@@ -190,10 +225,14 @@ void R_RenderDynamicLightmaps(msurface_t *fa)
 		goto dynamic;
 	}
 
-	// check for lightmap modification
-	for (int maps = 0; maps < MAXLIGHTMAPS && fa->styles[maps] != 255; maps++)
-		if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
-			goto dynamic;
+	// check for lightmap modification, only needed once one of its styles has changed
+	if (fa->lightstale)
+	{
+		for (int maps = 0; maps < MAXLIGHTMAPS && fa->styles[maps] != 255; maps++)
+			if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
+				goto dynamic;
+		fa->lightstale = false;
+	}
 
 	// dynamic this frame or dynamic previously
 	if (fa->dlightframe == r_framecount || fa->cached_dlight)
@@ -226,8 +265,18 @@ dynamic:
 	if (theRect->h + theRect->t < fa->light_t + tmax)
 		theRect->h = fa->light_t - theRect->t + tmax;
 	byte *base = lightmaps[fa->lightmaptexturenum];
-	base += fa->light_t * BLOCK_WIDTH + fa->light_s;
-	R_BuildLightMap(fa, base, BLOCK_WIDTH);
+	base += fa->light_t * lightmap_width + fa->light_s;
+	R_BuildLightMap(fa, base, lightmap_width);
+}
+
+/* flags the surfaces using a style so they are checked when next drawn */
+static void R_LightStyleChanged(int style)
+{
+	if (!style_surfaces)
+		return;
+
+	for (int i = style_firstsurface[style]; i < style_firstsurface[style + 1]; i++)
+		style_surfaces[i]->lightstale = true;
 }
 
 void R_AnimateLight(void)
@@ -239,6 +288,8 @@ void R_AnimateLight(void)
 	{
 		if (!cl_lightstyle[j].length)
 		{
+			if (d_lightstylevalue[j] != 256)
+				R_LightStyleChanged(j);
 			d_lightstylevalue[j] = 256;
 			continue;
 		}
@@ -246,6 +297,8 @@ void R_AnimateLight(void)
 		int k = i % cl_lightstyle[j].length;
 		k = cl_lightstyle[j].map[k] - 'a';
 		k = k * 22;
+		if (d_lightstylevalue[j] != k)
+			R_LightStyleChanged(j);
 		d_lightstylevalue[j] = k;
 	}
 }
@@ -437,41 +490,56 @@ int R_LightPoint(vec3_t p)
  ===============================================================================
  */
 
-/* returns a texture number and the position inside it */
+/* returns a texture number and the position inside it, opening a new page when all are full */
 static int AllocBlock(int w, int h, int *x, int *y)
 {
-	for (int texnum = 0; texnum < MAX_LIGHTMAPS; texnum++)
-	{
-		int best = BLOCK_HEIGHT;
+	int texnum;
 
-		for (int i = 0; i < BLOCK_WIDTH - w; i++)
-		{
-			int j, local_best = 0;
-			for (j = 0; j < w; j++)
-			{
-				if (allocated[texnum][i + j] >= best)
-					break;
-				if (allocated[texnum][i + j] > local_best)
-					local_best = allocated[texnum][i + j];
-			}
-			if (j == w)
-			{	// this is a valid spot
-				*x = i;
-				*y = best = local_best;
-			}
-		}
+	for (texnum = 0; texnum < lightmap_count; texnum++)
+		if (Atlas_Alloc(&lightmap_atlas[texnum], w, h, x, y))
+			return texnum;
 
-		if (best + h > BLOCK_HEIGHT)
-			continue;
+	if (lightmap_count == MAX_LIGHTMAPS)
+		Sys_Error("LightMaps full, try a larger gl_lightmapsize");
+
+	Atlas_Init(&lightmap_atlas[texnum], lightmap_width, lightmap_height);
+	lightmaps[texnum] = (byte *)Q_malloc(lightmap_width * lightmap_height);
+	memset(lightmaps[texnum], 0, lightmap_width * lightmap_height);
+	lightmap_count++;
+
+	if (!Atlas_Alloc(&lightmap_atlas[texnum], w, h, x, y))
+		Sys_Error("AllocBlock: %ix%i does not fit a %ix%i lightmap", w, h, lightmap_width, lightmap_height);
+
+	return texnum;
+}
+
+static void R_FreeLightmapPages(void)
+{
+	for (int i = 0; i < lightmap_count; i++)
+	{
+		Atlas_Shutdown(&lightmap_atlas[i]);
+		free(lightmaps[i]);
+		lightmaps[i] = NULL;
+	}
+	lightmap_count = 0;
+}
 
-		for (int i = 0; i < w; i++)
-			allocated[texnum][*x + i] = best + h;
+/* report how tightly the surfaces of the current map were packed */
+void R_LightmapStats_f(void)
+{
+	int used = 0;
 
-		return texnum;
+	for (int i = 0; i < lightmap_count; i++)
+	{
+		atlas_t *atlas = &lightmap_atlas[i];
+		Con_Printf("lightmap%03i: %5i blocks %5.1f%% used, top %i\n", i, atlas->numallocs,
+			   100.0 * atlas->usedarea / (atlas->width * atlas->height), Atlas_Top(atlas));
+		used += atlas->usedarea;
 	}
 
-	Sys_Error("LightMaps full");
-	return 0;
+	int total = lightmap_count * lightmap_width * lightmap_height;
+	Con_Printf("%i %ix%i lightmaps, %1.1f%% packed, built in %.1f ms\n", lightmap_count,
+		   lightmap_width, lightmap_height, total ? 100.0 * used / total : 0.0, lightmap_buildtime * 1000);
 }
 
 static void BuildSurfaceDisplayList(brush_model_t *brushmodel, int surface)
@@ -528,13 +596,13 @@ static void BuildSurfaceDisplayList(brush_model_t *brushmodel, int surface)
 		s -= fa->texturemins[0];
 		s += fa->light_s * 16;
 		s += 8;
-		s /= BLOCK_WIDTH * 16; //fa->texinfo->texture->width;
+		s /= lightmap_width * 16; //fa->texinfo->texture->width;
 
 		t = DotProduct (vec, fa->texinfo->vecs[1]) + fa->texinfo->vecs[1][3];
 		t -= fa->texturemins[1];
 		t += fa->light_t * 16;
 		t += 8;
-		t /= BLOCK_HEIGHT * 16; //fa->texinfo->texture->height;
+		t /= lightmap_height * 16; //fa->texinfo->texture->height;
 
 		poly->light_tex[i].s = s;
 		poly->light_tex[i].t = t;
@@ -551,8 +619,74 @@ static void GL_CreateSurfaceLightmap(msurface_t *surf)
 
 	surf->lightmaptexturenum = AllocBlock(smax, tmax, &surf->light_s, &surf->light_t);
 	byte *base = lightmaps[surf->lightmaptexturenum];
-	base += (surf->light_t * BLOCK_WIDTH + surf->light_s);
-	R_BuildLightMap(surf, base, BLOCK_WIDTH);
+	base += (surf->light_t * lightmap_width + surf->light_s);
+	R_BuildLightMap(surf, base, lightmap_width);
+}
+
+/* files each lightmapped surface under the animated styles it uses */
+static void GL_BuildStyleSurfaces(void)
+{
+	free(style_surfaces);
+	style_surfaces = NULL;
+	memset(style_firstsurface, 0, sizeof(style_firstsurface));
+
+	// count, then fill, walking the same surfaces both times
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int count[MAX_LIGHTSTYLES] = { 0 };
+
+		for (int i = 1; i < MAX_MODELS; i++)
+		{
+			model_t *m = cl.model_precache[i];
+			if (!m)
+				break;
+			if (m->name[0] == '*' || m->type != mod_brush)
+				continue;
+
+			brush_model_t *brushmodel = m->brushmodel;
+			for (int j = 0; j < brushmodel->numsurfaces; j++)
+			{
+				msurface_t *surf = &brushmodel->surfaces[j];
+				if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB))
+					continue;
+				for (int maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+				{
+					int style = surf->styles[maps];
+					if (style >= MAX_LIGHTSTYLES)
+						continue; // never animated
+					if (pass)
+						style_surfaces[style_firstsurface[style] + count[style]] = surf;
+					count[style]++;
+				}
+			}
+		}
+
+		if (!pass)
+		{
+			for (int style = 0; style < MAX_LIGHTSTYLES; style++)
+				style_firstsurface[style + 1] = style_firstsurface[style] + count[style];
+			style_surfaces = (msurface_t **)Q_malloc(sizeof(*style_surfaces) * (style_firstsurface[MAX_LIGHTSTYLES] + 1));
+		}
+	}
+}
+
+typedef struct
+{
+	msurface_t *surf;
+	int order;
+} lightmapsurf_t;
+
+/* tallest first packs the skyline tightest, ties keep load order so packing is repeatable */
+static int R_LightmapSurfCompare(const void *a, const void *b)
+{
+	const lightmapsurf_t *sa = (const lightmapsurf_t *)a;
+	const lightmapsurf_t *sb = (const lightmapsurf_t *)b;
+
+	if (sa->surf->extents[1] != sb->surf->extents[1])
+		return sb->surf->extents[1] - sa->surf->extents[1];
+	if (sa->surf->extents[0] != sb->surf->extents[0])
+		return sb->surf->extents[0] - sa->surf->extents[0];
+	return sa->order - sb->order;
 }
 
 /*
@@ -561,7 +695,14 @@ static void GL_CreateSurfaceLightmap(msurface_t *surf)
  */
 void GL_BuildLightmaps(void)
 {
-	memset(allocated, 0, sizeof(allocated));
+	double start = Sys_DoubleTime();
+
+	R_FreeLightmapPages();
+
+	lightmap_width = 64;
+	while (lightmap_width < gl_lightmapsize.value && lightmap_width < 1024)
+		lightmap_width <<= 1;
+	lightmap_height = lightmap_width;
 
 	r_framecount = 1; // no dlightcache
 
@@ -569,6 +710,46 @@ void GL_BuildLightmaps(void)
 	for (int i = 0; i < MAX_LIGHTMAPS; i++)
 		lightmap_textures[i] = NULL;
 
+	// gather the lightmapped surfaces of every brush model, count then fill
+	lightmapsurf_t *surfs = NULL;
+	int numsurfs = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		numsurfs = 0;
+		for (int i = 1; i < MAX_MODELS; i++)
+		{
+			model_t *m = cl.model_precache[i];
+			if (!m)
+				break;
+			if (m->name[0] == '*')
+				continue;
+			if (m->type != mod_brush)
+				continue;
+
+			brush_model_t *brushmodel = m->brushmodel;
+			for (int j = 0; j < brushmodel->numsurfaces; j++)
+			{
+				if (brushmodel->surfaces[j].flags & (SURF_DRAWSKY | SURF_DRAWTURB))
+					continue;
+				if (pass)
+				{
+					surfs[numsurfs].surf = &brushmodel->surfaces[j];
+					surfs[numsurfs].order = numsurfs;
+				}
+				numsurfs++;
+			}
+		}
+
+		if (!pass)
+			surfs = (lightmapsurf_t *)Q_malloc(sizeof(*surfs) * (numsurfs + 1));
+	}
+
+	qsort(surfs, numsurfs, sizeof(*surfs), R_LightmapSurfCompare);
+	for (int i = 0; i < numsurfs; i++)
+		GL_CreateSurfaceLightmap(surfs[i].surf);
+	free(surfs);
+
+	// the display lists need the final lightmap positions
 	for (int i = 1; i < MAX_MODELS; i++)
 	{
 		model_t *m = cl.model_precache[i];
@@ -584,28 +765,29 @@ void GL_BuildLightmaps(void)
 		{
 			if (brushmodel->surfaces[j].flags & (SURF_DRAWSKY | SURF_DRAWTURB))
 				continue;
-			GL_CreateSurfaceLightmap(&brushmodel->surfaces[j]);
 			BuildSurfaceDisplayList(brushmodel, j);
 		}
 	}
 
+	GL_BuildStyleSurfaces();
+	GL_BuildWorldVBO();
+
 	// upload all lightmaps that were filled
-	for (int i = 0; i < MAX_LIGHTMAPS; i++)
+	for (int i = 0; i < lightmap_count; i++)
 	{
-		if (!allocated[i][0])
-			break; // no more used
-
-		lightmap_rectchange[i].l = BLOCK_WIDTH;
-		lightmap_rectchange[i].t = BLOCK_HEIGHT;
+		lightmap_rectchange[i].l = lightmap_width;
+		lightmap_rectchange[i].t = lightmap_height;
 		lightmap_rectchange[i].w = 0;
 		lightmap_rectchange[i].h = 0;
 
 		static char name[16];
 		snprintf(name, 16, "lightmap%03i", i);
 		byte *data = lightmaps[i];
-		lightmap_textures[i] = TexMgr_LoadImage(name, BLOCK_WIDTH, BLOCK_HEIGHT,
-		                                        SRC_LIGHTMAP, data, TEX_LINEAR | TEX_NOPICMIP);
+		lightmap_textures[i] = TexMgr_LoadImage(name, lightmap_width, lightmap_height,
+		                                        SRC_LIGHTMAP, data, NULL, 0, TEX_LINEAR | TEX_NOPICMIP);
 
 		lightmap_modified[i] = false;
 	}
+
+	lightmap_buildtime = Sys_DoubleTime() - start;
 }
@@ -35,6 +35,7 @@ cvar_t gl_affinemodels = { "gl_affinemodels", "0" };
 cvar_t gl_polyblend = { "gl_polyblend", "1", CVAR_ARCHIVE };
 cvar_t gl_playermip = { "gl_playermip", "0", CVAR_ARCHIVE };
 cvar_t gl_overbright = { "gl_overbright", "1", CVAR_ARCHIVE };
+cvar_t gl_lightmapsize = { "gl_lightmapsize", "256", CVAR_ARCHIVE }; // takes effect on the next map
 
 void GL_RotateForEntity(entity_t *ent, Q_Matrix &matrix)
 {
@@ -307,6 +308,7 @@ void GL_Init(void)
 	Cvar_RegisterVariable(&gl_polyblend);
 	Cvar_RegisterVariable(&gl_playermip);
 	Cvar_RegisterVariable(&gl_overbright);
+	Cvar_RegisterVariable(&gl_lightmapsize);
 	Cvar_RegisterVariable(&gl_nearwater_fix);
 	Cvar_RegisterVariable(&gl_fadescreen_alpha);
 	Cvar_RegisterVariable(&gl_clear);
@@ -15,59 +15,58 @@
 #include "quakedef.h"
 #include "glquake.h"
 
-extern particle_t *active_particles;
+#include <cstddef>
+
 gltexture_t *particletexture; // little dot for particles
 
+/*
+ * Particles are streamed through one vertex buffer, a batch at a time. The
+ * buffer is orphaned before each batch so the driver never has to wait for
+ * the previous draw to finish with it.
+ */
+#define PARTICLE_BATCH 4096
+
+static GLuint particlebuffer;
+static particlevert_t particleverts[PARTICLE_BATCH * 3];
+
 void GL_DrawParticles(void)
 {
 	vec3_t up, right;
 
+	if (!cl_particles.count)
+		return;
+
 	VectorScale(vup, 1.5, up);
 	VectorScale(vright, 1.5, right);
 
-	GL_Bind(particletexture);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	byte alpha = CLAMP(0, r_particles_alpha.value, 1) * 255;
 
-	GLfloat texts[] = {
-		0, 0,
-		1, 0,
-		0, 1,
-	};
+	if (!particlebuffer)
+		glGenBuffers(1, &particlebuffer);
 
-	GLfloat verts[3*3];
+	GL_Bind(particletexture);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glEnableClientState(GL_COLOR_ARRAY);
 
-	glTexCoordPointer(2, GL_FLOAT, 0, texts);
-	glVertexPointer(3, GL_FLOAT, 0, verts);
+	glBindBuffer(GL_ARRAY_BUFFER, particlebuffer);
+	glVertexPointer(3, GL_FLOAT, sizeof(particlevert_t), (void *) offsetof(particlevert_t, xyz));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(particlevert_t), (void *) offsetof(particlevert_t, st));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(particlevert_t), (void *) offsetof(particlevert_t, color));
 
-	for (particle_t *p = active_particles; p; p = p->next)
+	for (int first = 0; first < cl_particles.count; first += PARTICLE_BATCH)
 	{
-		byte p_red = ((byte *)&d_8to24table[(int) p->color])[0];
-		byte p_green = ((byte *)&d_8to24table[(int) p->color])[1];
-		byte p_blue = ((byte *)&d_8to24table[(int) p->color])[2];
-		byte p_alpha = CLAMP(0, r_particles_alpha.value, 1) * 255;
-
-		// hack a scale up to keep particles from disappearing
-		float scale = (p->org[0] - r_origin[0]) * vpn[0] +
-		        (p->org[1] - r_origin[1]) * vpn[1] +
-		        (p->org[2] - r_origin[2]) * vpn[2];
-		if (scale < 20)
-			scale = 1;
-		else
-			scale = 1 + scale * 0.004;
-
-		glColor4ub(p_red, p_green, p_blue, p_alpha);
-		verts[0] = p->org[0];
-		verts[1] = p->org[1];
-		verts[2] = p->org[2];
-		verts[3] = p->org[0] + up[0] * scale;
-		verts[4] = p->org[1] + up[1] * scale;
-		verts[5] = p->org[2] + up[2] * scale;
-		verts[6] = p->org[0] + right[0] * scale;
-		verts[7] = p->org[1] + right[1] * scale;
-		verts[8] = p->org[2] + right[2] * scale;
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+		int count = min(cl_particles.count - first, PARTICLE_BATCH);
+		int numverts = CL_BuildParticleVerts(&cl_particles, first, count, particleverts,
+				r_origin, vpn, up, right, d_8to24table, alpha);
+
+		glBufferData(GL_ARRAY_BUFFER, sizeof(particleverts), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, numverts * sizeof(particlevert_t), particleverts);
+		glDrawArrays(GL_TRIANGLES, 0, numverts);
+		c_draw_calls++;
 	}
 
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_COLOR_ARRAY);
 	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 }
@@ -99,5 +98,5 @@ void GL_InitParticleTexture(void)
 			data[y][x][3] = dottexture[x][y] * 255;
 		}
 	}
-	particletexture = TexMgr_LoadImage("particle", 8, 8, SRC_RGBA, (byte *)data, TEX_PERSIST | TEX_ALPHA | TEX_LINEAR);
+	particletexture = TexMgr_LoadImage("particle", 8, 8, SRC_RGBA, (byte *)data, NULL, 0, TEX_PERSIST | TEX_ALPHA | TEX_LINEAR);
 }
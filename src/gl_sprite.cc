@@ -114,4 +114,5 @@ void R_DrawSpriteModel(entity_t *ent)
 	glTexCoordPointer(2, GL_FLOAT, 0, texts);
 	glVertexPointer(3, GL_FLOAT, 0, verts);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	c_draw_calls++;
 }
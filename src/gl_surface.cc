@@ -14,6 +14,8 @@
  * General Public License for more details.
  */
 
+#include <cstddef>
+
 #include "quakedef.h"
 #include "glquake.h"
 #include "model.h"
@@ -21,6 +23,35 @@
 #define	MAX_LIGHTMAPS   128
 extern gltexture_t *lightmap_textures[MAX_LIGHTMAPS];
 
+/*
+ * The world polygons live in one static vertex buffer built with the
+ * lightmaps. Short indices can only reach 65536 vertices, so the buffer
+ * is split into segments that each start a new vertex pointer, and a
+ * surface never straddles two of them.
+ */
+#define	VBO_SEGMENT_VERTS	65536
+#define	MAX_VBO_SEGMENTS	64
+#define	MAX_BATCH_INDICES	12288
+
+typedef struct
+{
+	vec3_t xyz;
+	float st[2];
+	float lightst[2];
+} worldvert_t;
+
+static GLuint world_vbo;
+static int world_segmentbase[MAX_VBO_SEGMENTS]; // first vertex of each segment
+static int world_numsegments;
+
+static GLushort batch_indices[MAX_BATCH_INDICES];
+static int batch_numindices;
+static int batch_segment;
+
+static msurface_t *lightmap_chains[MAX_LIGHTMAPS];
+static int lightmap_chainlist[MAX_LIGHTMAPS];
+static int lightmap_numchains;
+
 typedef struct glRect_s
 {
 	unsigned char l, t, w, h;
@@ -31,6 +62,7 @@ static void GL_DrawPoly(glpoly_t *p)
 	glTexCoordPointer(2, GL_FLOAT, 0, &p->tex[0]);
 	glVertexPointer(3, GL_FLOAT, 0, &p->verts[0][0]);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+	c_draw_calls++;
 }
 
 static void GL_DrawPolyLight(glpoly_t *p)
@@ -38,6 +70,7 @@ static void GL_DrawPolyLight(glpoly_t *p)
 	glTexCoordPointer(2, GL_FLOAT, 0, &p->light_tex[0]);
 	glVertexPointer(3, GL_FLOAT, 0, &p->verts[0][0]);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+	c_draw_calls++;
 }
 
 /* Returns the proper texture for a given time and base texture */
@@ -81,6 +114,7 @@ static void GL_DrawWaterPoly(glpoly_t *p)
 	glTexCoordPointer(2, GL_FLOAT, 0, &p->tex[0]);
 	glVertexPointer(3, GL_FLOAT, 0, &verts[0][0]);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+	c_draw_calls++;
 }
 
 /* Warp the vertex coordinates */
@@ -99,6 +133,7 @@ static void GL_DrawWaterPolyLight(glpoly_t *p)
 	glTexCoordPointer(2, GL_FLOAT, 0, &p->light_tex[0]);
 	glVertexPointer(3, GL_FLOAT, 0, &verts[0][0]);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+	c_draw_calls++;
 }
 
 static void GL_RenderBrushPoly(msurface_t *fa, int frame)
@@ -181,6 +216,181 @@ static void R_DrawWaterSurfaces(brush_model_t *brushmodel)
 	}
 }
 
+static int R_WorldSurfCompare(const void *a, const void *b)
+{
+	const msurface_t *sa = *(const msurface_t **)a;
+	const msurface_t *sb = *(const msurface_t **)b;
+
+	if (sa->texinfo->texture != sb->texinfo->texture)
+		return sa->texinfo->texture < sb->texinfo->texture ? -1 : 1;
+	return sa->lightmaptexturenum - sb->lightmaptexturenum;
+}
+
+/* uploads every lightmapped world polygon, grouped by texture and lightmap */
+void GL_BuildWorldVBO(void)
+{
+	brush_model_t *brushmodel = cl.worldmodel->brushmodel;
+
+	msurface_t **surfs = (msurface_t **)Q_malloc(sizeof(*surfs) * (brushmodel->numsurfaces + 1));
+	int numsurfs = 0, numverts = 0;
+	for (int i = 0; i < brushmodel->numsurfaces; i++)
+	{
+		msurface_t *surf = &brushmodel->surfaces[i];
+		surf->vbo_segment = -1;
+		if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB) || !surf->polys)
+			continue;
+		surfs[numsurfs++] = surf;
+		numverts += surf->polys->numverts;
+	}
+	qsort(surfs, numsurfs, sizeof(*surfs), R_WorldSurfCompare);
+
+	worldvert_t *verts = (worldvert_t *)Q_malloc(sizeof(*verts) * (numverts + 1));
+	int segment = 0, segmentverts = 0;
+	world_segmentbase[0] = 0;
+	numverts = 0;
+	for (int i = 0; i < numsurfs; i++)
+	{
+		glpoly_t *poly = surfs[i]->polys;
+		if (segmentverts + poly->numverts > VBO_SEGMENT_VERTS)
+		{
+			if (segment + 1 == MAX_VBO_SEGMENTS)
+				break; // the rest are drawn a polygon at a time
+			world_segmentbase[++segment] = numverts;
+			segmentverts = 0;
+		}
+
+		surfs[i]->vbo_segment = segment;
+		surfs[i]->vbo_firstvert = segmentverts;
+		for (int j = 0; j < poly->numverts; j++, numverts++)
+		{
+			VectorCopy(poly->verts[j], verts[numverts].xyz);
+			verts[numverts].st[0] = poly->tex[j].s;
+			verts[numverts].st[1] = poly->tex[j].t;
+			verts[numverts].lightst[0] = poly->light_tex[j].s;
+			verts[numverts].lightst[1] = poly->light_tex[j].t;
+		}
+		segmentverts += poly->numverts;
+	}
+	world_numsegments = segment + 1;
+
+	if (!world_vbo)
+		glGenBuffers(1, &world_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, world_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(*verts) * numverts, verts, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	free(verts);
+	free(surfs);
+}
+
+static void R_SetWorldPointers(int segment, size_t texcoords)
+{
+	size_t base = world_segmentbase[segment] * sizeof(worldvert_t);
+
+	glVertexPointer(3, GL_FLOAT, sizeof(worldvert_t), (void *) (base + offsetof(worldvert_t, xyz)));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(worldvert_t), (void *) (base + texcoords));
+}
+
+/* draws the gathered indices with the same passes as GL_RenderBrushPoly */
+static void R_FlushWorldBatch(texture_t *t, int lightmap)
+{
+	if (!batch_numindices)
+		return;
+
+	GL_Bind(t->gltexture);
+	R_SetWorldPointers(batch_segment, offsetof(worldvert_t, st));
+	glDrawElements(GL_TRIANGLES, batch_numindices, GL_UNSIGNED_SHORT, batch_indices);
+	c_draw_calls++;
+
+	GL_Bind(lightmap_textures[lightmap]);
+	R_UploadLightmap(lightmap);
+
+	glDepthMask(GL_FALSE); // don't bother writing Z
+	if (!r_lightmap.value)
+	{
+		if (gl_overbright.value)
+			glBlendFunc(GL_DST_COLOR, GL_SRC_COLOR);
+		else
+			glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+	}
+
+	R_SetWorldPointers(batch_segment, offsetof(worldvert_t, lightst));
+	glDrawElements(GL_TRIANGLES, batch_numindices, GL_UNSIGNED_SHORT, batch_indices);
+	c_draw_calls++;
+
+	if (t->fullbright != NULL && r_fullbright.value)
+	{
+		glBlendFunc(GL_ONE, GL_ONE);
+		GL_Bind(t->fullbright);
+		R_SetWorldPointers(batch_segment, offsetof(worldvert_t, st));
+		glDrawElements(GL_TRIANGLES, batch_numindices, GL_UNSIGNED_SHORT, batch_indices);
+		c_draw_calls++;
+	}
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_TRUE); // back to normal Z buffering
+
+	batch_numindices = 0;
+}
+
+/* draws a texture chain with one set of passes per lightmap page it touches */
+static void R_DrawTextureChainBatched(texture_t *base, msurface_t *chain)
+{
+	texture_t *t = R_TextureAnimation(0, base);
+
+	lightmap_numchains = 0;
+	for (msurface_t *s = chain; s; s = s->texturechain)
+	{
+		if (s->vbo_segment < 0 || ((s->flags & SURF_UNDERWATER) && r_waterwarp.value))
+		{
+			GL_RenderBrushPoly(s, 0);
+			continue;
+		}
+
+		c_brush_polys++;
+		R_RenderDynamicLightmaps(s);
+
+		int lightmap = s->lightmaptexturenum;
+		if (!lightmap_chains[lightmap])
+			lightmap_chainlist[lightmap_numchains++] = lightmap;
+		s->lightmapchain = lightmap_chains[lightmap];
+		lightmap_chains[lightmap] = s;
+	}
+
+	if (!lightmap_numchains)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, world_vbo);
+
+	for (int i = 0; i < lightmap_numchains; i++)
+	{
+		int lightmap = lightmap_chainlist[i];
+
+		for (msurface_t *s = lightmap_chains[lightmap]; s; s = s->lightmapchain)
+		{
+			int numverts = s->polys->numverts;
+			if (s->vbo_segment != batch_segment || batch_numindices + (numverts - 2) * 3 > MAX_BATCH_INDICES)
+			{
+				R_FlushWorldBatch(t, lightmap);
+				batch_segment = s->vbo_segment;
+			}
+
+			// the polygon is a fan
+			for (int j = 2; j < numverts; j++)
+			{
+				batch_indices[batch_numindices++] = s->vbo_firstvert;
+				batch_indices[batch_numindices++] = s->vbo_firstvert + j - 1;
+				batch_indices[batch_numindices++] = s->vbo_firstvert + j;
+			}
+		}
+
+		R_FlushWorldBatch(t, lightmap);
+		lightmap_chains[lightmap] = NULL;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void R_DrawSurfaces(brush_model_t *brushmodel)
 {
 	int i;
@@ -203,8 +413,15 @@ void R_DrawSurfaces(brush_model_t *brushmodel)
 		{
 			if (s->flags & SURF_DRAWTURB)
 				continue; // draw water later
-			for (; s; s = s->texturechain)
-				GL_RenderBrushPoly(s, 0);
+			if (r_batchworld.value && world_vbo)
+			{
+				R_DrawTextureChainBatched(t, s);
+			}
+			else
+			{
+				for (; s; s = s->texturechain)
+					GL_RenderBrushPoly(s, 0);
+			}
 		}
 
 		t->texturechain = NULL;
@@ -215,28 +432,10 @@ void R_DrawSurfaces(brush_model_t *brushmodel)
 
 void R_DrawBrushModel(entity_t *ent)
 {
-	vec3_t mins, maxs;
 	model_t *clmodel = ent->model;
-	bool rotated;
+	bool rotated = ent->angles[0] || ent->angles[1] || ent->angles[2];
 
-	if (ent->angles[0] || ent->angles[1] || ent->angles[2])
-	{
-		rotated = true;
-		for (int i = 0; i < 3; i++)
-		{
-			mins[i] = ent->origin[i] - clmodel->radius;
-			maxs[i] = ent->origin[i] + clmodel->radius;
-		}
-	}
-	else
-	{
-		rotated = false;
-		VectorAdd(ent->origin, clmodel->mins, mins);
-		VectorAdd(ent->origin, clmodel->maxs, maxs);
-	}
-
-	if (R_CullBox(mins, maxs))
-		return;
+	// culled by the entity queue
 
 	vec3_t modelorg;
 	VectorSubtract(r_refdef.vieworg, ent->origin, modelorg);
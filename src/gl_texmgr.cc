@@ -23,12 +23,19 @@
 static cvar_t gl_texturemode = { "gl_texturemode", "", CVAR_ARCHIVE };
 static cvar_t gl_texture_anisotropy = { "gl_texture_anisotropy", "0", CVAR_ARCHIVE };
 static cvar_t gl_max_size = { "gl_max_size", "0", CVAR_NONE };
+static cvar_t gl_texture_keepsource = { "gl_texture_keepsource", "0", CVAR_NONE };
 
 static GLint gl_hardware_maxsize;
 
 #define	MAX_GLTEXTURES	2048
 static int numgltextures;
 static gltexture_t *active_gltextures;
+
+// textures are indexed by name and by source content
+#define	TEXHASH_SIZE	1024
+static gltexture_t *name_hash[TEXHASH_SIZE];
+static gltexture_t *data_hash[TEXHASH_SIZE];
+static int numsharedloads; // loads satisfied by an identical texture
 gltexture_t *notexture, *nulltexture;
 
 unsigned int d_8to24table[256];
@@ -50,6 +57,7 @@ void GL_Bind(gltexture_t *texture)
 		currenttexture[currenttarget - GL_TEXTURE0] = texture->texnum;
 		glBindTexture(GL_TEXTURE_2D, texture->texnum);
 		texture->visframe = r_framecount;
+		c_texture_binds++;
 	}
 }
 
@@ -240,11 +248,40 @@ static void TexMgr_Anisotropy_f(cvar_t *var)
 	}
 }
 
+static size_t TexMgr_SourceSize(gltexture_t *glt)
+{
+	// SRC_RGBA is 4 bytes per pixel, all others are 1
+	size_t bpp = (glt->source_format == SRC_RGBA ? 4 : 1);
+	return glt->source_width * glt->source_height * bpp;
+}
+
+/* returns the source pixels, reading them back from the game file into the hunk if needed */
+static byte *TexMgr_SourceData(gltexture_t *glt)
+{
+	if (glt->source_data)
+		return glt->source_data;
+
+	if (!glt->source_file[0])
+		return NULL;
+
+	FILE *f;
+	if (COM_OpenFile(glt->source_file, &f) == -1 || !f)
+		return NULL;
+
+	size_t size = TexMgr_SourceSize(glt);
+	byte *data = (byte *) Hunk_Alloc(size);
+	fseek(f, glt->source_offset, SEEK_CUR);
+	size_t read = fread(data, 1, size, f);
+	COM_CloseFile(f);
+
+	return read == size ? data : NULL;
+}
+
 /* report loaded textures */
 static void TexMgr_Imagelist_f(void)
 {
-	float mb;
 	float texels = 0;
+	size_t sourcebytes = 0, filebytes = 0;
 	gltexture_t *glt;
 
 	for (glt = active_gltextures; glt; glt = glt->next)
@@ -254,10 +291,18 @@ static void TexMgr_Imagelist_f(void)
 			texels += glt->width * glt->height * 4.0f / 3.0f;
 		else
 			texels += (glt->width * glt->height);
+		if (glt->source_data)
+			sourcebytes += TexMgr_SourceSize(glt);
+		else
+			filebytes += TexMgr_SourceSize(glt);
 	}
 
-	mb = texels * (Cvar_VariableValue("vid_bpp") / 8.0f) / 0x100000;
-	Con_Printf("%i textures %i pixels %1.1f megabytes\n", numgltextures, (int) texels, mb);
+	float gpumb = texels * (Cvar_VariableValue("vid_bpp") / 8.0f) / 0x100000;
+	float sourcemb = sourcebytes / (float) 0x100000;
+	Con_Printf("%i textures %i pixels %1.1f megabytes\n", numgltextures, (int) texels, gpumb);
+	Con_Printf("%1.1f megabytes source, %1.1f megabytes total, %i shared loads\n",
+		   sourcemb, sourcemb + gpumb, numsharedloads);
+	Con_Printf("%1.1f megabytes reloadable from game files\n", filebytes / (float) 0x100000);
 }
 
 #ifndef OPENGLES
@@ -371,13 +416,85 @@ float TexMgr_FrameUsage(void)
 	return mb;
 }
 
+static unsigned int TexMgr_HashName(const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*name)
+		hash = (hash ^ (byte) *name++) * 16777619u;
+
+	return hash;
+}
+
+/* FNV-1a a word at a time, collisions are resolved by comparing the data */
+static unsigned int TexMgr_HashData(const byte *data, size_t size)
+{
+	unsigned int hash = 2166136261u;
+	size_t i;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		unsigned int word;
+		memcpy(&word, data + i, 4);
+		hash = (hash ^ word) * 16777619u;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+
+	return hash;
+}
+
+static void TexMgr_LinkName(gltexture_t *glt)
+{
+	gltexture_t **chain = &name_hash[TexMgr_HashName(glt->name) & (TEXHASH_SIZE - 1)];
+
+	glt->namenext = *chain;
+	*chain = glt;
+}
+
+static void TexMgr_LinkData(gltexture_t *glt)
+{
+	gltexture_t **chain = &data_hash[glt->source_hash & (TEXHASH_SIZE - 1)];
+
+	glt->datanext = *chain;
+	*chain = glt;
+}
+
+static void TexMgr_UnlinkName(gltexture_t *glt)
+{
+	gltexture_t **link = &name_hash[TexMgr_HashName(glt->name) & (TEXHASH_SIZE - 1)];
+
+	for (; *link; link = &(*link)->namenext)
+	{
+		if (*link == glt)
+		{
+			*link = glt->namenext;
+			return;
+		}
+	}
+}
+
+static void TexMgr_UnlinkData(gltexture_t *glt)
+{
+	gltexture_t **link = &data_hash[glt->source_hash & (TEXHASH_SIZE - 1)];
+
+	for (; *link; link = &(*link)->datanext)
+	{
+		if (*link == glt)
+		{
+			*link = glt->datanext;
+			return;
+		}
+	}
+}
+
 gltexture_t *TexMgr_FindTexture(const char *name)
 {
 	gltexture_t *glt;
 
 	if (name)
 	{
-		for (glt = active_gltextures; glt; glt = glt->next)
+		for (glt = name_hash[TexMgr_HashName(name) & (TEXHASH_SIZE - 1)]; glt; glt = glt->namenext)
 		{
 			if (!strcmp(glt->name, name))
 				return glt;
@@ -387,12 +504,36 @@ gltexture_t *TexMgr_FindTexture(const char *name)
 	return NULL;
 }
 
+/* finds an already uploaded texture made from the same pixels with the same flags */
+static gltexture_t *TexMgr_FindIdentical(unsigned int hash, int width, int height, enum srcformat format, byte *data, unsigned flags)
+{
+	gltexture_t *glt;
+
+	for (glt = data_hash[hash & (TEXHASH_SIZE - 1)]; glt; glt = glt->datanext)
+	{
+		if (glt->source_hash != hash || glt->flags != flags || glt->source_format != format)
+			continue;
+		if (glt->source_width != (unsigned) width || glt->source_height != (unsigned) height)
+			continue;
+
+		int mark = Hunk_LowMark();
+		byte *source = TexMgr_SourceData(glt);
+		bool same = source && !memcmp(source, data, TexMgr_SourceSize(glt));
+		Hunk_FreeToLowMark(mark);
+		if (same)
+			return glt;
+	}
+
+	return NULL;
+}
+
 gltexture_t *TexMgr_NewTexture(void)
 {
 	if (numgltextures == MAX_GLTEXTURES)
 		Sys_Error("numgltextures == MAX_GLTEXTURES\n");
 
 	gltexture_t *glt = (gltexture_t *)Q_malloc(sizeof(*glt));
+	memset(glt, 0, sizeof(*glt));
 	glt->next = active_gltextures;
 	active_gltextures = glt;
 
@@ -406,6 +547,17 @@ gltexture_t *TexMgr_NewTexture(void)
 // workaround for preventing TexMgr_FreeTexture during TexMgr_ReloadImages
 static bool in_reload_images;
 
+/* drops an already unlinked texture */
+static void TexMgr_ReleaseTexture(gltexture_t *kill)
+{
+	TexMgr_UnlinkName(kill);
+	TexMgr_UnlinkData(kill);
+	GL_DeleteTexture(kill);
+	free(kill->source_data);
+	free(kill);
+	numgltextures--;
+}
+
 void TexMgr_FreeTexture(gltexture_t *kill)
 {
 	gltexture_t *glt;
@@ -422,9 +574,7 @@ void TexMgr_FreeTexture(gltexture_t *kill)
 	if (active_gltextures == kill)
 	{
 		active_gltextures = kill->next;
-		GL_DeleteTexture(kill);
-		free(kill);
-		numgltextures--;
+		TexMgr_ReleaseTexture(kill);
 		return;
 	}
 
@@ -433,9 +583,7 @@ void TexMgr_FreeTexture(gltexture_t *kill)
 		if (glt->next == kill)
 		{
 			glt->next = kill->next;
-			GL_DeleteTexture(kill);
-			free(kill);
-			numgltextures--;
+			TexMgr_ReleaseTexture(kill);
 			return;
 		}
 	}
@@ -534,20 +682,52 @@ int TexMgr_PadConditional(int s)
 		return s;
 }
 
+/*
+ * The pixel kernels below work on whole RGBA pixels with the four-wide
+ * vectors from mathlib.h. Averaging two pixels per byte without widening
+ * uses (a & b) + ((a ^ b) >> 1), masking off the bit that the shift moves
+ * into the neighboring channel, which matches (a + b) >> 1 exactly.
+ */
+typedef unsigned long long vec4u64_t __attribute__((vector_size(32)));
+
+static inline vec4u_t TexMgr_AveragePixels(vec4u_t a, vec4u_t b)
+{
+	return (a & b) + ((a ^ b) >> 1 & 0x7f7f7f7f);
+}
+
+static inline vec4u_t TexMgr_LoadPixels(const unsigned *p)
+{
+	vec4u_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void TexMgr_StorePixels(unsigned *p, vec4u_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
 static unsigned *TexMgr_MipMapW(unsigned *data, int width, int height)
 {
-	int i, size;
-	byte *out, *in;
+	unsigned *out = data;
+	unsigned *in = data;
+	int size = (width * height) >> 1;
+	int i = 0;
 
-	out = in = (byte *) data;
-	size = (width * height) >> 1;
+	// each 64 bit lane holds a pixel pair, average its halves and narrow
+	for (; i + 4 <= size; i += 4, out += 4, in += 8)
+	{
+		vec4u64_t pairs;
+		memcpy(&pairs, in, sizeof(pairs));
+		vec4u_t left = __builtin_convertvector(pairs, vec4u_t);
+		vec4u_t right = __builtin_convertvector(pairs >> 32, vec4u_t);
+		TexMgr_StorePixels(out, TexMgr_AveragePixels(left, right));
+	}
 
-	for (i = 0; i < size; i++, out += 4, in += 8)
+	for (; i < size; i++, out++, in += 2)
 	{
-		out[0] = (in[0] + in[4]) >> 1;
-		out[1] = (in[1] + in[5]) >> 1;
-		out[2] = (in[2] + in[6]) >> 1;
-		out[3] = (in[3] + in[7]) >> 1;
+		unsigned a = in[0], b = in[1];
+		*out = (a & b) + ((a ^ b) >> 1 & 0x7f7f7f7f);
 	}
 
 	return data;
@@ -555,77 +735,76 @@ static unsigned *TexMgr_MipMapW(unsigned *data, int width, int height)
 
 static unsigned *TexMgr_MipMapH(unsigned *data, int width, int height)
 {
-	int i, j;
-	byte *out, *in;
+	unsigned *out = data;
+	unsigned *in = data;
 
-	out = in = (byte *) data;
 	height >>= 1;
-	width <<= 2;
 
-	for (i = 0; i < height; i++, in += width)
+	for (int i = 0; i < height; i++, in += width)
 	{
-		for (j = 0; j < width; j += 4, out += 4, in += 4)
+		int j = 0;
+		for (; j + 4 <= width; j += 4, out += 4, in += 4)
+			TexMgr_StorePixels(out, TexMgr_AveragePixels(TexMgr_LoadPixels(in), TexMgr_LoadPixels(in + width)));
+
+		for (; j < width; j++, out++, in++)
 		{
-			out[0] = (in[0] + in[width + 0]) >> 1;
-			out[1] = (in[1] + in[width + 1]) >> 1;
-			out[2] = (in[2] + in[width + 2]) >> 1;
-			out[3] = (in[3] + in[width + 3]) >> 1;
+			unsigned a = in[0], b = in[width];
+			*out = (a & b) + ((a ^ b) >> 1 & 0x7f7f7f7f);
 		}
 	}
 
 	return data;
 }
 
+static inline vec4i_t TexMgr_WidenPixel(const byte *p)
+{
+	vec4b_t v;
+	memcpy(&v, p, sizeof(v));
+	return __builtin_convertvector(v, vec4i_t);
+}
+
 /* bilinear resample */
 static unsigned *TexMgr_ResampleTexture(unsigned *in, int inwidth, int inheight, bool alpha)
 {
-	byte *nwpx, *nepx, *swpx, *sepx, *dest;
-	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump, outjump;
-	unsigned *out;
-	int i, j, outwidth, outheight;
-
 	if (inwidth == TexMgr_Pad(inwidth) && inheight == TexMgr_Pad(inheight))
 		return in;
 
-	outwidth = TexMgr_Pad(inwidth);
-	outheight = TexMgr_Pad(inheight);
-	out = (unsigned *) Hunk_Alloc(outwidth * outheight * 4);
+	int outwidth = TexMgr_Pad(inwidth);
+	int outheight = TexMgr_Pad(inheight);
+	unsigned *out = (unsigned *) Hunk_Alloc(outwidth * outheight * 4);
 
-	xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
-	yfrac = ((inheight - 1) << 16) / (outheight - 1);
-	y = outjump = 0;
+	unsigned xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
+	unsigned yfrac = ((inheight - 1) << 16) / (outheight - 1);
+	unsigned y = 0;
+	unsigned *dest = out;
 
-	for (i = 0; i < outheight; i++)
+	// all four channels of a pixel are filtered at once; the weights sum to
+	// 1 << 16, so 255 * 65536 is the largest intermediate
+	for (int i = 0; i < outheight; i++, y += yfrac)
 	{
-		mody = (y >> 8) & 0xFF;
-		imody = 256 - mody;
-		injump = (y >> 16) * inwidth;
-		x = 0;
+		int mody = (y >> 8) & 0xFF;
+		int imody = 256 - mody;
+		unsigned *row = in + (y >> 16) * inwidth;
+		unsigned x = 0;
 
-		for (j = 0; j < outwidth; j++)
+		for (int j = 0; j < outwidth; j++, x += xfrac, dest++)
 		{
-			modx = (x >> 8) & 0xFF;
-			imodx = 256 - modx;
+			int modx = (x >> 8) & 0xFF;
+			int imodx = 256 - modx;
 
-			nwpx = (byte *) (in + (x >> 16) + injump);
-			nepx = nwpx + 4;
-			swpx = nwpx + inwidth * 4;
-			sepx = swpx + 4;
+			const byte *nwpx = (const byte *) (row + (x >> 16));
+			const byte *swpx = nwpx + inwidth * 4;
 
-			dest = (byte *) (out + outjump + j);
+			vec4i_t sum = TexMgr_WidenPixel(nwpx) * (imodx * imody) +
+				TexMgr_WidenPixel(nwpx + 4) * (modx * imody) +
+				TexMgr_WidenPixel(swpx) * (imodx * mody) +
+				TexMgr_WidenPixel(swpx + 4) * (modx * mody);
 
-			dest[0] = (nwpx[0] * imodx * imody + nepx[0] * modx * imody + swpx[0] * imodx * mody + sepx[0] * modx * mody) >> 16;
-			dest[1] = (nwpx[1] * imodx * imody + nepx[1] * modx * imody + swpx[1] * imodx * mody + sepx[1] * modx * mody) >> 16;
-			dest[2] = (nwpx[2] * imodx * imody + nepx[2] * modx * imody + swpx[2] * imodx * mody + sepx[2] * modx * mody) >> 16;
-			if (alpha)
-				dest[3] = (nwpx[3] * imodx * imody + nepx[3] * modx * imody + swpx[3] * imodx * mody + sepx[3] * modx * mody) >> 16;
-			else
-				dest[3] = 255;
-
-			x += xfrac;
+			vec4b_t pixel = __builtin_convertvector(sum >> 16, vec4b_t);
+			if (!alpha)
+				pixel[3] = 255;
+			memcpy(dest, &pixel, sizeof(pixel));
 		}
-		outjump += outwidth;
-		y += yfrac;
 	}
 
 	return out;
@@ -807,12 +986,18 @@ static void TexMgr_PadEdgeFixH(byte *data, int width, int height)
 
 static unsigned *TexMgr_8to32(byte *in, int pixels, unsigned int *usepal)
 {
-	int i;
-	unsigned *out, *data;
+	unsigned *data = (unsigned *) Hunk_Alloc(pixels * 4);
+	unsigned *out = data;
+	int i = 0;
 
-	out = data = (unsigned *) Hunk_Alloc(pixels * 4);
+	// a palette lookup is a gather, so just keep four of them in flight
+	for (; i + 4 <= pixels; i += 4, in += 4, out += 4)
+	{
+		vec4u_t v = { usepal[in[0]], usepal[in[1]], usepal[in[2]], usepal[in[3]] };
+		TexMgr_StorePixels(out, v);
+	}
 
-	for (i = 0; i < pixels; i++)
+	for (; i < pixels; i++)
 		*out++ = usepal[*in++];
 
 	return data;
@@ -995,35 +1180,45 @@ static void TexMgr_LoadLightmap(gltexture_t *glt, byte *data)
 	TexMgr_SetFilterModes(glt);
 }
 
-/* the one entry point for loading all textures */
-gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data, unsigned flags)
+/*
+ * the one entry point for loading all textures. when source_file is given,
+ * data must be the unmodified bytes at source_offset in that file, and the
+ * texture re-reads them from there instead of keeping its own copy
+ */
+gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data,
+                              const char *source_file, src_offset_t source_offset, unsigned flags)
 {
-	unsigned short crc;
 	gltexture_t *glt;
 	int mark;
 
+	// SRC_RGBA is 4 bytes per pixel, all others are 1
+	size_t bpp = (format == SRC_RGBA ? 4 : 1);
+	size_t data_size = width * height * bpp;
+
 	// cache check
-	switch (format)
-	{
-	case SRC_INDEXED:
-		crc = CRC_Block(data, width * height);
-		break;
-	case SRC_LIGHTMAP:
-		crc = CRC_Block(data, width * height * 1);
-		break;
-	case SRC_RGBA:
-		crc = CRC_Block(data, width * height * 4);
-		break;
-	default: /* not reachable but avoids compiler warnings */
-		crc = 0;
-	}
+	unsigned int hash = TexMgr_HashData(data, data_size);
 	if ((flags & TEX_OVERWRITE) && (glt = TexMgr_FindTexture(name)))
 	{
-		if (glt->source_crc == crc)
+		if (glt->source_hash == hash)
 			return glt;
+		TexMgr_UnlinkName(glt);
+		TexMgr_UnlinkData(glt);
+		free(glt->source_data);
+		glt->source_data = NULL;
 	}
 	else
 	{
+		// overwritten images and lightmaps are updated in place, so never share them
+		if (!(flags & TEX_OVERWRITE) && format != SRC_LIGHTMAP)
+		{
+			glt = TexMgr_FindIdentical(hash, width, height, format, data, flags);
+			if (glt)
+			{
+				numsharedloads++;
+				return glt;
+			}
+		}
+
 		glt = TexMgr_NewTexture();
 		if (glt == NULL)
 			return NULL;
@@ -1039,13 +1234,21 @@ gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcf
 	glt->source_format = format;
 	glt->source_width = width;
 	glt->source_height = height;
-	glt->source_crc = crc;
-
-	// SRC_RGBA is 4 bytes per pixel, all others are 1
-	size_t bpp = (format == SRC_RGBA ? 4 : 1);
-	size_t data_size = width * height * bpp;
-	glt->source_data = (byte *)Q_malloc(data_size);
-	memcpy(glt->source_data, data, data_size);
+	glt->source_hash = hash;
+	if (source_file && source_file[0] && !gl_texture_keepsource.value)
+	{
+		strlcpy(glt->source_file, source_file, sizeof(glt->source_file));
+		glt->source_offset = source_offset;
+	}
+	else
+	{
+		glt->source_file[0] = 0;
+		glt->source_offset = 0;
+		glt->source_data = (byte *)Q_malloc(data_size);
+		memcpy(glt->source_data, data, data_size);
+	}
+	TexMgr_LinkName(glt);
+	TexMgr_LinkData(glt);
 
 	//upload it
 	mark = Hunk_LowMark();
@@ -1082,13 +1285,15 @@ void TexMgr_ReloadImage(gltexture_t *glt, int shirt, int pants)
 	byte translation[256];
 	byte *src, *dst, *data, *translated;
 	int size, i;
+	int mark = Hunk_LowMark();
 //
 // get source data
 //
-	data = (byte *) glt->source_data; // image in memory
+	data = TexMgr_SourceData(glt); // image in memory or in a game file
 	if (!data)
 	{
 		Con_Printf("TexMgr_ReloadImage: invalid source for %s\n", glt->name);
+		Hunk_FreeToLowMark(mark);
 		return;
 	}
 
@@ -1164,6 +1369,251 @@ void TexMgr_ReloadImage(gltexture_t *glt, int shirt, int pants)
 		TexMgr_LoadImage32(glt, (unsigned *)data);
 		break;
 	}
+
+	Hunk_FreeToLowMark(mark);
+}
+
+/*
+ ================================================================================
+
+ KERNEL BENCHMARK
+
+ ================================================================================
+ */
+
+/*
+ * The original byte-at-a-time kernels, kept to check the vector versions
+ * against. Resampling here always produces a padded copy.
+ */
+static unsigned *TexMgr_MipMapW_Ref(unsigned *data, int width, int height)
+{
+	int i, size;
+	byte *out, *in;
+
+	out = in = (byte *) data;
+	size = (width * height) >> 1;
+
+	for (i = 0; i < size; i++, out += 4, in += 8)
+	{
+		out[0] = (in[0] + in[4]) >> 1;
+		out[1] = (in[1] + in[5]) >> 1;
+		out[2] = (in[2] + in[6]) >> 1;
+		out[3] = (in[3] + in[7]) >> 1;
+	}
+
+	return data;
+}
+
+static unsigned *TexMgr_MipMapH_Ref(unsigned *data, int width, int height)
+{
+	int i, j;
+	byte *out, *in;
+
+	out = in = (byte *) data;
+	height >>= 1;
+	width <<= 2;
+
+	for (i = 0; i < height; i++, in += width)
+	{
+		for (j = 0; j < width; j += 4, out += 4, in += 4)
+		{
+			out[0] = (in[0] + in[width + 0]) >> 1;
+			out[1] = (in[1] + in[width + 1]) >> 1;
+			out[2] = (in[2] + in[width + 2]) >> 1;
+			out[3] = (in[3] + in[width + 3]) >> 1;
+		}
+	}
+
+	return data;
+}
+
+static unsigned *TexMgr_ResampleTexture_Ref(unsigned *in, int inwidth, int inheight, bool alpha)
+{
+	byte *nwpx, *nepx, *swpx, *sepx, *dest;
+	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump, outjump;
+	unsigned *out;
+	int i, j, outwidth, outheight;
+
+	outwidth = TexMgr_Pad(inwidth);
+	outheight = TexMgr_Pad(inheight);
+	out = (unsigned *) Hunk_Alloc(outwidth * outheight * 4);
+
+	xfrac = ((inwidth - 1) << 16) / (outwidth - 1);
+	yfrac = ((inheight - 1) << 16) / (outheight - 1);
+	y = outjump = 0;
+
+	for (i = 0; i < outheight; i++)
+	{
+		mody = (y >> 8) & 0xFF;
+		imody = 256 - mody;
+		injump = (y >> 16) * inwidth;
+		x = 0;
+
+		for (j = 0; j < outwidth; j++)
+		{
+			modx = (x >> 8) & 0xFF;
+			imodx = 256 - modx;
+
+			nwpx = (byte *) (in + (x >> 16) + injump);
+			nepx = nwpx + 4;
+			swpx = nwpx + inwidth * 4;
+			sepx = swpx + 4;
+
+			dest = (byte *) (out + outjump + j);
+
+			dest[0] = (nwpx[0] * imodx * imody + nepx[0] * modx * imody + swpx[0] * imodx * mody + sepx[0] * modx * mody) >> 16;
+			dest[1] = (nwpx[1] * imodx * imody + nepx[1] * modx * imody + swpx[1] * imodx * mody + sepx[1] * modx * mody) >> 16;
+			dest[2] = (nwpx[2] * imodx * imody + nepx[2] * modx * imody + swpx[2] * imodx * mody + sepx[2] * modx * mody) >> 16;
+			if (alpha)
+				dest[3] = (nwpx[3] * imodx * imody + nepx[3] * modx * imody + swpx[3] * imodx * mody + sepx[3] * modx * mody) >> 16;
+			else
+				dest[3] = 255;
+
+			x += xfrac;
+		}
+		outjump += outwidth;
+		y += yfrac;
+	}
+
+	return out;
+}
+
+static unsigned *TexMgr_8to32_Ref(byte *in, int pixels, unsigned int *usepal)
+{
+	int i;
+	unsigned *out, *data;
+
+	out = data = (unsigned *) Hunk_Alloc(pixels * 4);
+
+	for (i = 0; i < pixels; i++)
+		*out++ = usepal[*in++];
+
+	return data;
+}
+
+static bool TexMgr_CanBench(gltexture_t *glt)
+{
+	if (glt->source_width < 2 || glt->source_height < 2)
+		return false;
+
+	return glt->source_format == SRC_INDEXED || glt->source_format == SRC_RGBA;
+}
+
+/* the CPU side of loading an image, returns the whole mip chain */
+static unsigned *TexMgr_RunKernels(gltexture_t *glt, byte *source, bool ref)
+{
+	int width = glt->source_width;
+	int height = glt->source_height;
+
+	unsigned *in = (unsigned *) source;
+	if (glt->source_format == SRC_INDEXED)
+	{
+		if (ref)
+			in = TexMgr_8to32_Ref(source, width * height, d_8to24table);
+		else
+			in = TexMgr_8to32(source, width * height, d_8to24table);
+	}
+
+	int outwidth = TexMgr_Pad(width);
+	int outheight = TexMgr_Pad(height);
+	unsigned *data;
+	if (outwidth == width && outheight == height)
+	{
+		data = (unsigned *) Hunk_Alloc(width * height * 4);
+		memcpy(data, in, width * height * 4);
+	}
+	else if (ref)
+	{
+		data = TexMgr_ResampleTexture_Ref(in, width, height, true);
+	}
+	else
+	{
+		data = TexMgr_ResampleTexture(in, width, height, true);
+	}
+
+	unsigned *mips = (unsigned *) Hunk_Alloc(outwidth * outheight * 4 * 2);
+	memcpy(mips, data, outwidth * outheight * 4);
+	int offset = outwidth * outheight;
+	for (int mipwidth = outwidth, mipheight = outheight; mipwidth > 1 || mipheight > 1; )
+	{
+		if (mipwidth > 1)
+		{
+			if (ref)
+				TexMgr_MipMapW_Ref(data, mipwidth, mipheight);
+			else
+				TexMgr_MipMapW(data, mipwidth, mipheight);
+			mipwidth >>= 1;
+		}
+		if (mipheight > 1)
+		{
+			if (ref)
+				TexMgr_MipMapH_Ref(data, mipwidth, mipheight);
+			else
+				TexMgr_MipMapH(data, mipwidth, mipheight);
+			mipheight >>= 1;
+		}
+		memcpy(mips + offset, data, mipwidth * mipheight * 4);
+		offset += mipwidth * mipheight;
+	}
+
+	return mips;
+}
+
+static double TexMgr_TimeKernels(byte **sources, bool ref)
+{
+	double start = Sys_DoubleTime();
+	int i = 0;
+
+	for (gltexture_t *glt = active_gltextures; glt; glt = glt->next, i++)
+	{
+		if (!sources[i])
+			continue;
+
+		int mark = Hunk_LowMark();
+		TexMgr_RunKernels(glt, sources[i], ref);
+		Hunk_FreeToLowMark(mark);
+	}
+
+	return Sys_DoubleTime() - start;
+}
+
+/* runs every loaded image through both kernel sets, checking they agree */
+static void TexMgr_Imagebench_f(void)
+{
+	int count = 0, mismatches = 0;
+	int i;
+
+	// read any sources kept in game files up front, so the timings are only the kernels
+	int sourcemark = Hunk_LowMark();
+	byte **sources = (byte **) Hunk_Alloc(numgltextures * sizeof(*sources));
+	gltexture_t *glt;
+	for (glt = active_gltextures, i = 0; glt; glt = glt->next, i++)
+		sources[i] = TexMgr_CanBench(glt) ? TexMgr_SourceData(glt) : NULL;
+
+	for (glt = active_gltextures, i = 0; glt; glt = glt->next, i++)
+	{
+		if (!sources[i])
+			continue;
+
+		int mark = Hunk_LowMark();
+		unsigned *ref_out = TexMgr_RunKernels(glt, sources[i], true);
+		unsigned *vec_out = TexMgr_RunKernels(glt, sources[i], false);
+		int size = TexMgr_Pad(glt->source_width) * TexMgr_Pad(glt->source_height) * 4 * 2;
+		if (memcmp(ref_out, vec_out, size))
+		{
+			Con_Printf("mismatch: %s\n", glt->name);
+			mismatches++;
+		}
+		Hunk_FreeToLowMark(mark);
+		count++;
+	}
+
+	double ref_time = TexMgr_TimeKernels(sources, true);
+	double vec_time = TexMgr_TimeKernels(sources, false);
+	Hunk_FreeToLowMark(sourcemark);
+
+	Con_Printf("%i images, %i mismatches: %.1f ms reference, %.1f ms vectorized\n",
+		   count, mismatches, ref_time * 1000, vec_time * 1000);
 }
 
 /* must be called before any texture loading */
@@ -1182,11 +1632,15 @@ void TexMgr_Init(void)
 	// init texture list
 	active_gltextures = NULL;
 	numgltextures = 0;
+	numsharedloads = 0;
+	memset(name_hash, 0, sizeof(name_hash));
+	memset(data_hash, 0, sizeof(data_hash));
 
 	// palette
 	TexMgr_LoadPalette();
 
 	Cvar_RegisterVariable(&gl_max_size);
+	Cvar_RegisterVariable(&gl_texture_keepsource);
 	Cvar_RegisterVariable(&gl_texture_anisotropy);
 	Cvar_SetCallback(&gl_texture_anisotropy, &TexMgr_Anisotropy_f);
 	gl_texturemode.string = (char *) glmodes[glmode_idx].name;
@@ -1194,6 +1648,7 @@ void TexMgr_Init(void)
 	Cvar_SetCallback(&gl_texturemode, &TexMgr_TextureMode_f);
 	Cmd_AddCommand("gl_describetexturemodes", &TexMgr_DescribeTextureModes_f);
 	Cmd_AddCommand("imagelist", &TexMgr_Imagelist_f);
+	Cmd_AddCommand("imagebench", &TexMgr_Imagebench_f);
 #ifndef OPENGLES
 	Cmd_AddCommand("imagedump", &TexMgr_Imagedump_f);
 #endif
@@ -1202,8 +1657,8 @@ void TexMgr_Init(void)
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &gl_hardware_maxsize);
 
 	// load notexture images
-	notexture = TexMgr_LoadImage("notexture", 2, 2, SRC_INDEXED, notexture_data, TEX_NEAREST | TEX_PERSIST | TEX_NOPICMIP);
-	nulltexture = TexMgr_LoadImage("nulltexture", 2, 2, SRC_INDEXED, nulltexture_data, TEX_NEAREST | TEX_PERSIST | TEX_NOPICMIP);
+	notexture = TexMgr_LoadImage("notexture", 2, 2, SRC_INDEXED, notexture_data, NULL, 0, TEX_NEAREST | TEX_PERSIST | TEX_NOPICMIP);
+	nulltexture = TexMgr_LoadImage("nulltexture", 2, 2, SRC_INDEXED, nulltexture_data, NULL, 0, TEX_NEAREST | TEX_PERSIST | TEX_NOPICMIP);
 
 	//have to assign these here becuase Mod_Init is called before TexMgr_Init
 	r_notexture_mip->gltexture = r_notexture_mip2->gltexture = notexture;
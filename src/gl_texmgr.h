@@ -52,6 +52,8 @@ typedef struct gltexture_s
 //managed by texture manager
 	GLuint texnum;
 	struct gltexture_s *next;
+	struct gltexture_s *namenext; //next in name hash chain
+	struct gltexture_s *datanext; //next in content hash chain
 //managed by image loading
 	char name[64];
 	unsigned int width; //size of image as it exists in opengl
@@ -60,8 +62,10 @@ typedef struct gltexture_s
 	enum srcformat source_format; //format of pixel data (indexed, lightmap, or rgba)
 	unsigned int source_width; //size of image in source data
 	unsigned int source_height; //size of image in source data
-	byte *source_data;
-	unsigned short source_crc; //generated by source data before modifications
+	byte *source_data; //NULL when the pixels can be read back from source_file
+	char source_file[MAX_QPATH]; //game file the pixels were loaded from, or empty
+	src_offset_t source_offset; //byte offset of the pixels in source_file
+	unsigned int source_hash; //generated by source data before modifications
 	char shirt; //0-13 shirt color, or -1 if never colormapped
 	char pants; //0-13 pants color, or -1 if never colormapped
 //used for rendering
@@ -93,7 +97,8 @@ void TexMgr_Init(void);
 void TexMgr_DeleteTextureObjects(void);
 
 // IMAGE LOADING
-gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data, unsigned flags);
+gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data,
+                              const char *source_file, src_offset_t source_offset, unsigned flags);
 void TexMgr_ReloadImage(gltexture_t *glt, int shirt, int pants);
 void TexMgr_ReloadImages(void);
 void TexMgr_ReloadNobrightImages(void);
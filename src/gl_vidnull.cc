@@ -37,7 +37,9 @@ qpic_t *Draw_MakePic(const char *name, int width, int height, byte *data) { retu
 void Draw_Init(void) { return; }
 
 void R_DrawAliasModel(entity_t *ent) { return; }
+void R_EndAliasModels(void) { return; }
+gltexture_t *R_AliasSkin(entity_t *ent, gltexture_t **fullbright) { return NULL; }
 void R_DrawBrushModel(entity_t *ent) { return; }
 void R_DrawSpriteModel(entity_t *ent) { return; }
 
-gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data, unsigned flags) { return NULL; }
+gltexture_t *TexMgr_LoadImage(const char *name, int width, int height, enum srcformat format, byte *data, const char *source_file, src_offset_t source_offset, unsigned flags) { return NULL; }
@@ -183,6 +183,7 @@ void EmitWaterPolys(msurface_t *fa)
 		glTexCoordPointer(2, GL_FLOAT, 0, texcord);
 		glVertexPointer(3, GL_FLOAT, 0, &p->verts[0][0]);
 		glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+		c_draw_calls++;
 	}
 }
 
@@ -224,6 +225,7 @@ void EmitSkyPolys(msurface_t *fa)
 
 		glVertexPointer(3, GL_FLOAT, 0, &p->verts[0][0]);
 		glDrawArrays(GL_TRIANGLE_FAN, 0, p->numverts);
+		c_draw_calls++;
 	}
 }
 
@@ -259,7 +261,7 @@ void Sky_LoadTexture(texture_t *mt)
 			back_data[(i * 128) + j] = src[i * 256 + j + 128];
 
 	snprintf(texturename, sizeof(texturename), "%s_back", mt->name);
-	solidskytexture = TexMgr_LoadImage(texturename, 128, 128, SRC_INDEXED, back_data, TEX_NOFLAGS);
+	solidskytexture = TexMgr_LoadImage(texturename, 128, 128, SRC_INDEXED, back_data, NULL, 0, TEX_NOFLAGS);
 
 	// extract front layer and upload
 	for (int i = 0; i < 128; i++)
@@ -271,5 +273,5 @@ void Sky_LoadTexture(texture_t *mt)
 		}
 
 	snprintf(texturename, sizeof(texturename), "%s_front", mt->name);
-	alphaskytexture = TexMgr_LoadImage(texturename, 128, 128, SRC_INDEXED, front_data, TEX_ALPHA);
+	alphaskytexture = TexMgr_LoadImage(texturename, 128, 128, SRC_INDEXED, front_data, NULL, 0, TEX_ALPHA);
 }
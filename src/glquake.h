@@ -19,6 +19,7 @@
 #include <GLES/gl.h>
 #include <GLES/glext.h>
 #else
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #include <GL/glext.h>
 #endif
@@ -39,6 +40,8 @@ extern bool gl_texture_NPOT;
 
 extern int r_framecount;
 extern int c_brush_polys, c_alias_polys;
+extern int c_draw_calls;
+extern int c_texture_binds, c_buffer_binds;
 
 extern float gldepthmin, gldepthmax;
 
@@ -61,6 +64,7 @@ extern cvar_t r_dynamic;
 extern cvar_t r_novis;
 extern cvar_t r_particles;
 extern cvar_t r_particles_alpha;
+extern cvar_t r_batchworld;
 
 // fenix@io.com: model interpolation
 extern cvar_t r_interpolate_animation;
@@ -73,6 +77,7 @@ extern cvar_t gl_smoothmodels;
 extern cvar_t gl_affinemodels;
 extern cvar_t gl_polyblend;
 extern cvar_t gl_overbright;
+extern cvar_t gl_lightmapsize;
 
 //extern cvar_t gl_flashblend;
 //extern cvar_t	gl_doubleeyes;
@@ -101,6 +106,8 @@ typedef enum {
 
 // gl_alias.c
 void R_DrawAliasModel(entity_t *ent);
+void R_EndAliasModels(void);
+gltexture_t *R_AliasSkin(entity_t *ent, gltexture_t **fullbright);
 
 // gl_draw.c
 void Scrap_Upload(void);
@@ -131,12 +138,14 @@ void R_MarkLights(dlight_t *light, int bit, mnode_t *node);
 void R_PushDlights(void);
 int R_LightPoint(vec3_t p);
 void GL_BuildLightmaps(void);
+void R_LightmapStats_f(void);
 
 // gl_main.c
 void GL_RotateForEntity(entity_t *ent, Q_Matrix &matrix);
 void GL_PolyBlend(void);
 bool R_CullBox(vec3_t mins, vec3_t maxs);
-bool R_CullForEntity(const entity_t *ent);
+int R_CullBoxes(const vec3_t *mins, const vec3_t *maxs, bool *culled, int count);
+void R_EntityBounds(const entity_t *ent, vec3_t mins, vec3_t maxs);
 void GL_Setup(void);
 void R_TranslatePlayerSkin(int playernum);
 void GL_Init(void);
@@ -153,6 +162,7 @@ void R_DrawSpriteModel(entity_t *ent);
 
 // gl_surface.c
 void R_DrawSurfaces(brush_model_t *brushmodel);
+void GL_BuildWorldVBO(void);
 void R_DrawBrushModel(entity_t *ent);
 
 // gl_vidsdl.c
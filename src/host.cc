@@ -19,6 +19,7 @@
 
 #include "quakedef.h"
 #include "glquake.h"
+#include "jobs.h"
 
 char host_worldname[MAX_QPATH];
 
@@ -809,6 +810,7 @@ void Host_Init(quakeparms_t *parms)
 	M_Init();
 	PR_Init();
 	Mod_Init();
+	R_InitVis();
 	NET_Init();
 	SV_Init();
 
@@ -870,6 +872,7 @@ void Host_Shutdown(void)
 	NET_Shutdown();
 	S_Shutdown();
 	IN_Shutdown();
+	Jobs_Shutdown();
 
 	if (cls.state != ca_dedicated)
 	{
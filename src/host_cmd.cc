@@ -520,6 +520,7 @@ void Host_Noclip_f(void)
 		Con_Printf("noclip [value] : toggle noclip mode. values: 0 = off, 1 = on\n");
 		break;
 	}
+	ED_Dirty(sv_player);
 	//johnfitz
 }
 
@@ -572,6 +573,7 @@ void Host_Fly_f(void)
 		Con_Printf("fly [value] : toggle fly mode. values: 0 = off, 1 = on\n");
 		break;
 	}
+	ED_Dirty(sv_player);
 	//johnfitz
 }
 
@@ -1433,6 +1435,7 @@ void Host_Spawn_f(void)
 		ent = host_client->edict;
 
 		memset(&ent->v, 0, progs->entityfields * 4);
+		ED_Dirty(ent);
 		ent->v.colormap = NUM_FOR_EDICT(ent);
 		ent->v.team = (host_client->colors & 15) + 1;
 		ent->v.netname = PR_SetEngineString(host_client->name);
@@ -0,0 +1,130 @@
+/*
+ * Worker threads for splitting per-frame work into jobs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "jobs.h"
+
+static std::thread jobs_workers[MAX_JOB_THREADS - 1];
+static int jobs_numworkers;
+
+static std::mutex jobs_lock;
+static std::condition_variable jobs_wake; // a new batch was posted
+static std::condition_variable jobs_idle; // a worker finished its part of a batch
+static unsigned int jobs_batch; // bumped for every batch
+static int jobs_active; // workers taking part in the current batch
+static int jobs_busy; // workers still inside the current batch
+static bool jobs_quit;
+
+static void (*jobs_func)(void *data, int job);
+static void *jobs_data;
+static int jobs_count;
+static std::atomic<int> jobs_next;
+
+static void Jobs_Work(void)
+{
+	int job;
+
+	while ((job = jobs_next.fetch_add(1)) < jobs_count)
+		jobs_func(jobs_data, job);
+}
+
+static void Jobs_WorkerMain(int worker)
+{
+	unsigned int batch = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(jobs_lock);
+			jobs_wake.wait(lock, [&] { return jobs_quit || (jobs_batch != batch && worker < jobs_active); });
+			if (jobs_quit)
+				return;
+			batch = jobs_batch;
+		}
+
+		Jobs_Work();
+
+		std::lock_guard<std::mutex> lock(jobs_lock);
+		if (--jobs_busy == 0)
+			jobs_idle.notify_one();
+	}
+}
+
+void Jobs_Run(void (*func)(void *data, int job), void *data, int numjobs, int numthreads)
+{
+	int workers = numthreads - 1;
+	if (workers > MAX_JOB_THREADS - 1)
+		workers = MAX_JOB_THREADS - 1;
+	if (workers > numjobs - 1)
+		workers = numjobs - 1;
+
+	if (workers <= 0)
+	{
+		for (int job = 0; job < numjobs; job++)
+			func(data, job);
+		return;
+	}
+
+	while (jobs_numworkers < workers)
+	{
+		jobs_workers[jobs_numworkers] = std::thread(Jobs_WorkerMain, jobs_numworkers);
+		jobs_numworkers++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobs_lock);
+		jobs_func = func;
+		jobs_data = data;
+		jobs_count = numjobs;
+		jobs_next = 0;
+		jobs_active = workers;
+		jobs_busy = workers;
+		jobs_batch++;
+	}
+	jobs_wake.notify_all();
+
+	Jobs_Work();
+
+	std::unique_lock<std::mutex> lock(jobs_lock);
+	jobs_idle.wait(lock, [] { return jobs_busy == 0; });
+}
+
+void Jobs_Shutdown(void)
+{
+	for (int i = 0; i < jobs_numworkers; i++)
+		if (jobs_workers[i].get_id() == std::this_thread::get_id())
+			return; // a job hit an error, the process is exiting anyway
+
+	{
+		std::lock_guard<std::mutex> lock(jobs_lock);
+		jobs_quit = true;
+	}
+	jobs_wake.notify_all();
+
+	for (int i = 0; i < jobs_numworkers; i++)
+		jobs_workers[i].join();
+	jobs_numworkers = 0;
+	jobs_quit = false;
+}
+
+int Jobs_NumCPUs(void)
+{
+	int cpus = std::thread::hardware_concurrency();
+
+	return cpus < 1 ? 1 : cpus > MAX_JOB_THREADS ? MAX_JOB_THREADS : cpus;
+}
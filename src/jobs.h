@@ -0,0 +1,32 @@
+/*
+ * Worker threads for splitting per-frame work into jobs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef __JOBS_H
+#define __JOBS_H
+
+#define	MAX_JOB_THREADS	16
+
+/*
+ * Runs func(data, job) for every job in [0, numjobs) on up to numthreads
+ * threads, the calling thread being one of them, and returns once all
+ * have finished. Workers are started the first time they are needed.
+ * Jobs must not touch the console, the hunk or anything else that
+ * isn't their own.
+ */
+void Jobs_Run(void (*func)(void *data, int job), void *data, int numjobs, int numthreads);
+void Jobs_Shutdown(void);
+
+int Jobs_NumCPUs(void);
+
+#endif /* __JOBS_H */
@@ -64,6 +64,34 @@ int BoxOnPlaneSide(vec3_t emins, vec3_t emaxs, mplane_t *p);
 	: \
 		BoxOnPlaneSide( (emins), (emaxs), (p)))
 
+/*
+ * Four-wide float vectors using the compiler's vector extensions, which
+ * become SSE on x86 and NEON on ARM, with plain scalar code elsewhere.
+ * Loads and stores don't need any particular alignment.
+ */
+typedef vec_t vec4f_t __attribute__((vector_size(16)));
+typedef int vec4i_t __attribute__((vector_size(16)));
+typedef unsigned int vec4u_t __attribute__((vector_size(16)));
+typedef unsigned char vec4b_t __attribute__((vector_size(4)));
+
+static inline vec4f_t V4_Load(const vec_t *p)
+{
+	vec4f_t v;
+	__builtin_memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void V4_Store(vec_t *p, vec4f_t v)
+{
+	__builtin_memcpy(p, &v, sizeof(v));
+}
+
+static inline vec4f_t V4_Set(vec_t f)
+{
+	vec4f_t v = { f, f, f, f };
+	return v;
+}
+
 float anglemod(float a);
 float RadiusFromBounds(vec3_t mins, vec3_t maxs);
 int ParseFloats(const char *s, float *f, int *f_size);
@@ -194,13 +194,13 @@ static void *Mod_LoadAllSkins(alias_model_t *aliasmodel, daliasskintype_t *pskin
 				aliasmodel->gl_texturenum[i][0] =
 				aliasmodel->gl_texturenum[i][1] =
 				aliasmodel->gl_texturenum[i][2] =
-				aliasmodel->gl_texturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, TEX_MIPMAP);
+				aliasmodel->gl_texturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, NULL, 0, TEX_MIPMAP);
 
 				snprintf(name, sizeof(name), "%s_%zu_glowwww", mod_name, i);
 				aliasmodel->gl_fbtexturenum[i][0] =
 				aliasmodel->gl_fbtexturenum[i][1] =
 				aliasmodel->gl_fbtexturenum[i][2] =
-				aliasmodel->gl_fbtexturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, TEX_MIPMAP | TEX_FULLBRIGHT);
+				aliasmodel->gl_fbtexturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, NULL, 0, TEX_MIPMAP | TEX_FULLBRIGHT);
 			}
 			else
 			{
@@ -208,7 +208,7 @@ static void *Mod_LoadAllSkins(alias_model_t *aliasmodel, daliasskintype_t *pskin
 				aliasmodel->gl_texturenum[i][0] =
 				aliasmodel->gl_texturenum[i][1] =
 				aliasmodel->gl_texturenum[i][2] =
-				aliasmodel->gl_texturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, TEX_MIPMAP);
+				aliasmodel->gl_texturenum[i][3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, NULL, 0, TEX_MIPMAP);
 
 				aliasmodel->gl_fbtexturenum[i][0] =
 				aliasmodel->gl_fbtexturenum[i][1] =
@@ -231,7 +231,7 @@ static void *Mod_LoadAllSkins(alias_model_t *aliasmodel, daliasskintype_t *pskin
 			{
 				Mod_FloodFillSkin(skin, aliasmodel->skinwidth, aliasmodel->skinheight);
 				snprintf(name, sizeof(name), "%s_%zu_%zu", mod_name, i, j);
-				aliasmodel->gl_texturenum[i][j & 3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, TEX_MIPMAP);
+				aliasmodel->gl_texturenum[i][j & 3] = TexMgr_LoadImage(name, aliasmodel->skinwidth, aliasmodel->skinheight, SRC_INDEXED, skin, NULL, 0, TEX_MIPMAP);
 				skin += skinsize;
 			}
 			pskintype = (daliasskintype_t *)skin;
@@ -341,5 +341,7 @@ void Mod_LoadAliasModel(model_t *mod, void *buffer)
 
 	mod->radius = RadiusFromBounds(mod->mins, mod->maxs);
 
+	aliasmodel->vbo = aliasmodel->ibo = 0; // the renderer uploads the poses when first drawn
+
 	mod->aliasmodel = aliasmodel;
 }
@@ -121,6 +121,10 @@ void Mod_LoadTextures(brush_model_t *brushmodel, lump_t *l, byte *mod_base, char
 			tx->offsets[j] = mt->offsets[j] + sizeof(texture_t) - sizeof(miptex_t);
 		// the pixels immediately follow the structures
 
+		// textures whose pixels are intact can be re-read from the bsp instead of being kept in memory
+		const char *source_file = mod_name;
+		src_offset_t offset = (src_offset_t)(mt+1) - (src_offset_t)mod_base;
+
 		// ericw -- check for pixels extending past the end of the lump.
 		// appears in the wild; e.g. jam2_tronyn.bsp (func_mapjam2),
 		// kellbase1.bsp (quoth), and can lead to a segfault if we read past
@@ -129,6 +133,7 @@ void Mod_LoadTextures(brush_model_t *brushmodel, lump_t *l, byte *mod_base, char
 		{
 			Con_DPrintf("Texture %s extends past end of lump\n", mt->name);
 			pixels = max(0, (mod_base + l->fileofs + l->filelen) - (byte*)(mt+1));
+			source_file = NULL;
 		}
 		memcpy ( tx+1, mt+1, pixels);
 
@@ -143,9 +148,8 @@ void Mod_LoadTextures(brush_model_t *brushmodel, lump_t *l, byte *mod_base, char
 			{
 
 					snprintf (texturename, sizeof(texturename), "%s:%s", mod_name, tx->name);
-//					offset = (src_offset_t)(mt+1) - (src_offset_t)mod_base;
 					tx->gltexture = TexMgr_LoadImage (texturename, tx->width, tx->height,
-						SRC_INDEXED, (byte *)(tx+1), TEX_NOFLAGS);
+						SRC_INDEXED, (byte *)(tx+1), source_file, offset, TEX_NOFLAGS);
 			}
 			else //regular texture
 			{
@@ -160,19 +164,18 @@ void Mod_LoadTextures(brush_model_t *brushmodel, lump_t *l, byte *mod_base, char
 				//external textures -- first look in "textures/mapname/" then look in "textures/"
 
 					snprintf (texturename, sizeof(texturename), "%s:%s", mod_name, tx->name);
-//					offset = (src_offset_t)(mt+1) - (src_offset_t)mod_base;
 					if (Mod_CheckFullbrights ((byte *)(tx+1), pixels))
 					{
 						tx->gltexture = TexMgr_LoadImage (texturename, tx->width, tx->height,
-							SRC_INDEXED, (byte *)(tx+1), TEX_MIPMAP | extraflags);
+							SRC_INDEXED, (byte *)(tx+1), source_file, offset, TEX_MIPMAP | extraflags);
 						snprintf (texturename, sizeof(texturename), "%s:%s_glow", mod_name, tx->name);
 						tx->fullbright = TexMgr_LoadImage (texturename, tx->width, tx->height,
-							SRC_INDEXED, (byte *)(tx+1), TEX_MIPMAP | TEX_FULLBRIGHT | extraflags);
+							SRC_INDEXED, (byte *)(tx+1), source_file, offset, TEX_MIPMAP | TEX_FULLBRIGHT | extraflags);
 					}
 					else
 					{
 						tx->gltexture = TexMgr_LoadImage (texturename, tx->width, tx->height,
-							SRC_INDEXED, (byte *)(tx+1), TEX_MIPMAP | extraflags);
+							SRC_INDEXED, (byte *)(tx+1), source_file, offset, TEX_MIPMAP | extraflags);
 					}
 			}
 		}
@@ -747,6 +750,74 @@ void Mod_MakeHull0(brush_model_t *brushmodel)
 	}
 }
 
+/*
+ * Compile a clipping hull for the tracers. Each node takes its plane along
+ * and the nodes are laid out breadth first from the submodel heads, so the
+ * top levels of every tree share cache lines. Returns the compiled number of
+ * each clipnode, -1 for the ones no head reaches.
+ */
+static int *Mod_CompileHull(brush_model_t *brushmodel, int hullnum, char *mod_name)
+{
+	hull_t *hull = &brushmodel->hulls[hullnum];
+	int count = hull->lastclipnode + 1;
+	int *remap = (int *)Q_malloc(count * sizeof(*remap));
+	int *queue = (int *)Q_malloc(count * sizeof(*queue));
+	int numnodes = 0;
+
+	for (int i = 0; i < count; i++)
+		remap[i] = -1;
+
+	for (int i = 0; i < brushmodel->numsubmodels; i++)
+	{
+		int num = brushmodel->submodels[i].headnode[hullnum];
+		if (num >= count)
+			Sys_Error("Mod_CompileHull: bad node number in %s", mod_name);
+		if (num < 0 || remap[num] != -1)
+			continue;
+		remap[num] = numnodes;
+		queue[numnodes++] = num;
+	}
+
+	for (int i = 0; i < numnodes; i++)
+	{
+		dclipnode_t *in = &hull->clipnodes[queue[i]];
+		for (int j = 0; j < 2; j++)
+		{
+			int num = in->children[j];
+			if (num >= count)
+				Sys_Error("Mod_CompileHull: bad node number in %s", mod_name);
+			if (num < 0 || remap[num] != -1)
+				continue;
+			remap[num] = numnodes;
+			queue[numnodes++] = num;
+		}
+	}
+
+	// on the hunk like the textures, so it goes when Mod_ClearAll has the model reloaded
+	byte *buf = (byte *)Hunk_AllocName(numnodes * sizeof(mclipnode_t) + 31, mod_name);
+	mclipnode_t *out = (mclipnode_t *)(((uintptr_t) buf + 31) & ~(uintptr_t) 31);
+
+	hull->nodes = out;
+	hull->numnodes = numnodes;
+
+	for (int i = 0; i < numnodes; i++, out++)
+	{
+		dclipnode_t *in = &hull->clipnodes[queue[i]];
+		mplane_t *plane = &hull->planes[in->planenum];
+
+		VectorCopy(plane->normal, out->normal);
+		out->dist = plane->dist;
+		out->type = plane->type;
+		out->pad = 0;
+		for (int j = 0; j < 2; j++)
+			out->children[j] = in->children[j] < 0 ? in->children[j] : remap[in->children[j]];
+	}
+
+	free(queue);
+
+	return remap;
+}
+
 void Mod_LoadBrushModel(model_t *mod, void *buffer)
 {
 	dheader_t *header = (dheader_t *) buffer;
@@ -783,6 +854,12 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
 
 	Mod_MakeHull0(brushmodel);
 
+	// hull 3 is never traced
+	int *remap[MAX_MAP_HULLS] = { NULL };
+	for (int j = 0; j < MAX_MAP_HULLS; j++)
+		if (brushmodel->hulls[j].available)
+			remap[j] = Mod_CompileHull(brushmodel, j, mod_name);
+
 	mod->numframes = 2; // regular and alternate animation
 
 	mod->type = mod_brush;
@@ -805,6 +882,11 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
 			brushmodel->hulls[j].firstclipnode = bm->headnode[j];
 			brushmodel->hulls[j].lastclipnode = brushmodel->numclipnodes - 1;
 		}
+		for (int j = 0; j < MAX_MAP_HULLS; j++)
+		{
+			int num = bm->headnode[j];
+			brushmodel->hulls[j].firstnode = (remap[j] && num >= 0) ? remap[j][num] : num;
+		}
 
 		brushmodel->firstmodelsurface = bm->firstface;
 		brushmodel->nummodelsurfaces = bm->numfaces;
@@ -830,4 +912,7 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
 			mod = loadmodel;
 		}
 	}
+
+	for (int j = 0; j < MAX_MAP_HULLS; j++)
+		free(remap[j]);
 }
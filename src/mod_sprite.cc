@@ -18,7 +18,7 @@
 #include "glquake.h"
 #include "model.h"
 
-static void *Mod_LoadSpriteFrame(mspriteframe_t *pspriteframe, dspriteframe_t *pinframe, int framenum, char *mod_name)
+static void *Mod_LoadSpriteFrame(mspriteframe_t *pspriteframe, dspriteframe_t *pinframe, int framenum, byte *mod_base, char *mod_name)
 {
 	int origin[2];
 	char name[64];
@@ -42,12 +42,13 @@ static void *Mod_LoadSpriteFrame(mspriteframe_t *pspriteframe, dspriteframe_t *p
 	pspriteframe->tmax = (float)height/(float)TexMgr_PadConditional(height);
 
 	snprintf(name, sizeof(name), "%s_%i", mod_name, framenum);
-	pspriteframe->gltexture = TexMgr_LoadImage (name, width, height, SRC_INDEXED, frame, TEX_PAD | TEX_ALPHA | TEX_NOPICMIP);
+	src_offset_t offset = (src_offset_t) frame - (src_offset_t) mod_base;
+	pspriteframe->gltexture = TexMgr_LoadImage (name, width, height, SRC_INDEXED, frame, mod_name, offset, TEX_PAD | TEX_ALPHA | TEX_NOPICMIP);
 
 	return (void *)(frame + size);
 }
 
-static void *Mod_LoadAllSpriteFrames(sprite_model_t *spritemodel, dspriteframetype_t *pframetype, char *mod_name)
+static void *Mod_LoadAllSpriteFrames(sprite_model_t *spritemodel, dspriteframetype_t *pframetype, byte *mod_base, char *mod_name)
 {
 	int posenum = 0;
 	spritemodel->framedescs = (mspriteframedesc_t *)Q_malloc(sizeof(*spritemodel->framedescs) * spritemodel->numframes);
@@ -60,7 +61,7 @@ static void *Mod_LoadAllSpriteFrames(sprite_model_t *spritemodel, dspriteframety
 			spritemodel->framedescs[i].poses = (mspriteframe_t *)Q_malloc(sizeof(*spritemodel->framedescs[i].poses));
 			pframetype = (dspriteframetype_t *)Mod_LoadSpriteFrame(&spritemodel->framedescs[i].poses[0],
 			                                                       (dspriteframe_t *)(pframetype + 1),
-									       posenum++, mod_name);
+									       posenum++, mod_base, mod_name);
 		}
 		else
 		{
@@ -80,7 +81,7 @@ static void *Mod_LoadAllSpriteFrames(sprite_model_t *spritemodel, dspriteframety
 			for (int j = 0; j < numposes; j++)
 				pframetype = (dspriteframetype_t *)Mod_LoadSpriteFrame(&spritemodel->framedescs[i].poses[j],
 				                                                       (dspriteframe_t *)(pin_intervals),
-										       posenum++, mod_name);
+										       posenum++, mod_base, mod_name);
 		}
 	}
 
@@ -110,7 +111,7 @@ void Mod_LoadSpriteModel(model_t *mod, void *buffer)
 
 	// load the frames
 	dspriteframetype_t *pframetype = (dspriteframetype_t *)(pinmodel + 1);
-	pframetype = (dspriteframetype_t *)Mod_LoadAllSpriteFrames(spritemodel, pframetype, mod_name);
+	pframetype = (dspriteframetype_t *)Mod_LoadAllSpriteFrames(spritemodel, pframetype, (byte *) buffer, mod_name);
 
 	mod->numframes = spritemodel->numframes;
 
@@ -124,17 +124,22 @@ typedef struct msurface_s {
 	byte styles[MAXLIGHTMAPS];
 	int cached_light[MAXLIGHTMAPS]; // values currently used in lightmap
 	bool cached_dlight; // true if dynamic light in cache
+	bool lightstale; // a style it uses has changed value since it was built
 	byte *samples; // [numstyles*surfsize]
 
 	int draw_this_frame;
 
 	bool overbright;
+
+	// position in the static world vertex buffer
+	int vbo_segment; // -1 if not in the buffer
+	int vbo_firstvert; // relative to the segment
+	struct msurface_s *lightmapchain; // batching by lightmap page while drawing
 } msurface_t;
 
 typedef struct mnode_s {
 	// common with leaf
 	int contents; // 0, to differentiate from leafs
-	int visframe; // node needs to be traversed if current
 
 	float minmaxs[6]; // for bounding box culling
 
@@ -151,7 +156,6 @@ typedef struct mnode_s {
 typedef struct mleaf_s {
 	// common with node
 	int contents; // wil be a negative contents number
-	int visframe; // node needs to be traversed if current
 
 	float minmaxs[6]; // for bounding box culling
 
@@ -167,11 +171,23 @@ typedef struct mleaf_s {
 	byte ambient_sound_level[NUM_AMBIENTS];
 } mleaf_t;
 
+// a clipnode with its plane, 32 bytes and 32 byte aligned for tracing
+typedef struct {
+	float normal[3];
+	float dist;
+	int children[2]; // negative numbers are contents
+	int type; // plane type, axial below 3
+	int pad;
+} mclipnode_t;
+
 typedef struct {
 	dclipnode_t *clipnodes;
 	mplane_t *planes;
 	int firstclipnode;
 	int lastclipnode;
+	mclipnode_t *nodes; // the reachable clipnodes, breadth first
+	int numnodes;
+	int firstnode;
 	vec3_t clip_mins;
 	vec3_t clip_maxs;
 	int available;
@@ -280,6 +296,7 @@ typedef struct {
 typedef struct {
 	float interval;
 	mtrivertx_t *posevirts;
+	size_t vbo_offset; // of the positions in the model's vertex buffer
 } mpose_t;
 
 typedef struct {
@@ -346,6 +363,8 @@ typedef struct
 
 	size_t numframes;
 	maliasframedesc_t *frames;
+
+	unsigned int vbo, ibo; // GL buffers, made the first time the model is drawn
 } alias_model_t;
 
 //===================================================================
@@ -847,12 +847,14 @@ void PF_findradius(void)
 	ent = NEXT_EDICT(sv.edicts);
 	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
 	{
-		if (ent->free)
+		edhot_t *hot = ED_Hot(i);
+
+		if (hot->free)
 			continue;
-		if (ent->v.solid == SOLID_NOT)
+		if (hot->solid == SOLID_NOT)
 			continue;
 		for (j = 0; j < 3; j++)
-			eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j]) * 0.5);
+			eorg[j] = org[j] - (hot->origin[j] + (hot->mins[j] + hot->maxs[j]) * 0.5);
 		if (VectorLength(eorg) > rad)
 			continue;
 
@@ -1214,9 +1216,13 @@ void PF_aim(void)
 {
 	edict_t *ent, *check, *bestent;
 	vec3_t start, dir, end, bestdir;
-	int i, j;
+	int i, j, numaim;
 	trace_t tr;
 	float dist, bestdist;
+	static vec3_t aimstarts[MAX_EDICTS], aimends[MAX_EDICTS];
+	static float aimdists[MAX_EDICTS];
+	static edict_t *aimchecks[MAX_EDICTS];
+	static trace_t aimtraces[MAX_EDICTS];
 //	float speed;
 
 	ent = G_EDICT(OFS_PARM0);
@@ -1240,6 +1246,8 @@ void PF_aim(void)
 	bestdist = sv_aim.value;
 	bestent = NULL;
 
+	// trace to everything within the turn limit at once, then pick in edict order
+	numaim = 0;
 	check = NEXT_EDICT(sv.edicts);
 	for (i = 1; i < sv.num_edicts; i++, check = NEXT_EDICT(check))
 	{
@@ -1256,11 +1264,23 @@ void PF_aim(void)
 		dist = DotProduct(dir, pr_global_struct->v_forward);
 		if (dist < bestdist)
 			continue;	// too far to turn
-		tr = SV_Move(start, vec3_origin, vec3_origin, end, false, ent);
-		if (tr.ent == check)
+		VectorCopy(start, aimstarts[numaim]);
+		VectorCopy(end, aimends[numaim]);
+		aimdists[numaim] = dist;
+		aimchecks[numaim] = check;
+		numaim++;
+	}
+
+	SV_MoveBatch(aimstarts, aimends, numaim, vec3_origin, vec3_origin, false, ent, aimtraces);
+
+	for (i = 0; i < numaim; i++)
+	{
+		if (aimdists[i] < bestdist)
+			continue;	// too far to turn
+		if (aimtraces[i].ent == aimchecks[i])
 		{	// can shoot at this one
-			bestdist = dist;
-			bestent = check;
+			bestdist = aimdists[i];
+			bestent = aimchecks[i];
 		}
 	}
 
@@ -16,6 +16,8 @@
 
 #include "quakedef.h"
 
+#include <cstddef>
+
 dprograms_t *progs;
 dfunction_t *pr_functions;
 
@@ -207,11 +209,84 @@ int PR_SetEngineString(const char *s)
 
 // ----------------------------------------------------
 
+edhot_t ed_hot[MAX_EDICTS];
+unsigned int ed_dirty[MAX_EDICTS / 32];
+unsigned int ed_changed[MAX_EDICTS / 32];
+bool ed_anychanged;
+
+bool ed_watched[sizeof(entvars_t) / 4];
+
+static void ED_Watch(size_t ofs, size_t size)
+{
+	for (size_t i = ofs / 4; i < (ofs + size) / 4; i++)
+		ed_watched[i] = true;
+}
+
+#define	WATCH(field) ED_Watch(offsetof(entvars_t, field), sizeof(((entvars_t *) 0)->field))
+
+/* The fields ed_hot copies, and the ones that wake sleeping edicts */
+static void ED_InitWatched(void)
+{
+	WATCH(origin);
+	WATCH(mins);
+	WATCH(maxs);
+	WATCH(absmin);
+	WATCH(absmax);
+	WATCH(movetype);
+	WATCH(solid);
+	WATCH(modelindex);
+	WATCH(nextthink);
+
+	WATCH(velocity);
+	WATCH(flags);
+	WATCH(groundentity);
+	WATCH(watertype);
+	WATCH(waterlevel);
+}
+
+static void ED_CopyHot(edict_t *ed, edhot_t *hot)
+{
+	VectorCopy(ed->v.origin, hot->origin);
+	VectorCopy(ed->v.mins, hot->mins);
+	VectorCopy(ed->v.maxs, hot->maxs);
+	VectorCopy(ed->v.absmin, hot->absmin);
+	VectorCopy(ed->v.absmax, hot->absmax);
+	hot->movetype = ed->v.movetype;
+	hot->solid = ed->v.solid;
+	hot->modelindex = ed->v.modelindex;
+	hot->nextthink = ed->v.nextthink;
+	hot->free = ed->free;
+}
+
+void ED_Refresh(int num)
+{
+	ED_CopyHot(EDICT_NUM(num), &ed_hot[num]);
+	ed_dirty[num >> 5] &= ~(1u << (num & 31));
+}
+
+void ED_Dirty(edict_t *ed)
+{
+	int num = NUM_FOR_EDICT(ed);
+
+	ed_dirty[num >> 5] |= 1u << (num & 31);
+	ed_changed[num >> 5] |= 1u << (num & 31);
+	ed_anychanged = true;
+}
+
+/* For when the edicts are allocated again */
+void ED_DirtyAll(void)
+{
+	memset(ed_dirty, 0xff, sizeof(ed_dirty));
+	memset(ed_changed, 0xff, sizeof(ed_changed));
+	ed_anychanged = true;
+}
+
 /* Sets everything to NULL */
 static void ED_ClearEdict(edict_t *e)
 {
 	memset(&e->v, 0, progs->entityfields * 4);
 	e->free = false;
+	ED_Dirty(e);
 }
 
 /*
@@ -251,7 +326,7 @@ edict_t *ED_Alloc(void)
 /* FIXME: walk all entities and NULL out references to this entity */
 void ED_Free(edict_t *ed)
 {
-	SV_UnlinkEdict(ed); // unlink from world bsp
+	SV_RemoveEdict(ed); // unlink from world bsp
 
 	ed->free = true;
 	ed->v.model = 0;
@@ -264,6 +339,7 @@ void ED_Free(edict_t *ed)
 	VectorCopy(vec3_origin, ed->v.angles);
 	ed->v.nextthink = -1;
 	ed->v.solid = 0;
+	ED_Dirty(ed);
 
 	ed->freetime = sv.time;
 }
@@ -785,6 +861,8 @@ const char *ED_ParseEdict(const char *data, edict_t *ent)
 	if (!init)
 		ent->free = true;
 
+	ED_Dirty(ent);
+
 	return data;
 }
 
@@ -997,11 +1075,90 @@ static void ED_Count_f(void)
 	Con_SafePrintf("step      :%3i\n", step);
 }
 
+/*
+ * Checks ed_hot against the edicts and times a PF_findradius style scan
+ * over the edicts and over ed_hot
+ */
+static void ED_HotBench_f(void)
+{
+	int passes = (Cmd_Argc() > 1) ? max(atoi(Cmd_Argv(1)), 1) : 1000;
+	int stale = 0, hits[2] = { 0, 0 };
+	double times[2];
+
+	if (!sv.active)
+	{
+		Con_Printf("Not running a server\n");
+		return;
+	}
+
+	for (int i = 0; i < sv.num_edicts; i++)
+	{
+		edhot_t hot;
+
+		if (ed_dirty[i >> 5] & (1u << (i & 31)))
+			continue;
+		memset(&hot, 0, sizeof(hot));
+		ED_CopyHot(EDICT_NUM(i), &hot);
+		if (memcmp(&hot, &ed_hot[i], sizeof(hot)))
+			stale++;
+	}
+
+	// a sphere around the first client
+	edict_t *client = EDICT_NUM(1);
+	vec3_t org;
+	VectorCopy(client->v.origin, org);
+	float rad = 1024;
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		double start = Sys_DoubleTime();
+
+		for (int n = 0; n < passes; n++)
+		{
+			for (int i = 1; i < sv.num_edicts; i++)
+			{
+				vec3_t eorg;
+
+				if (pass == 0)
+				{
+					edict_t *ent = EDICT_NUM(i);
+
+					if (ent->free || ent->v.solid == SOLID_NOT)
+						continue;
+					for (int j = 0; j < 3; j++)
+						eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j]) * 0.5);
+				}
+				else
+				{
+					edhot_t *hot = ED_Hot(i);
+
+					if (hot->free || hot->solid == SOLID_NOT)
+						continue;
+					for (int j = 0; j < 3; j++)
+						eorg[j] = org[j] - (hot->origin[j] + (hot->mins[j] + hot->maxs[j]) * 0.5);
+				}
+				if (VectorLength(eorg) <= rad)
+					hits[pass]++;
+			}
+		}
+
+		times[pass] = Sys_DoubleTime() - start;
+	}
+
+	Con_Printf("%i edicts, %i bytes each, %i bytes hot\n", sv.num_edicts, pr_edict_size, (int) sizeof(edhot_t));
+	Con_Printf("%i stale copies\n", stale);
+	Con_Printf("edicts: %.3f us per scan\n", times[0] * 1000000 / passes);
+	Con_Printf("ed_hot: %.3f us per scan\n", times[1] * 1000000 / passes);
+	if (hits[0] != hits[1])
+		Con_Printf("scans disagree: %i vs %i\n", hits[0] / passes, hits[1] / passes);
+}
+
 void PR_Init(void)
 {
 	Cmd_AddCommand("edict", ED_PrintEdict_f);
 	Cmd_AddCommand("edicts", ED_PrintEdicts_f);
 	Cmd_AddCommand("edictcount", ED_Count_f);
+	Cmd_AddCommand("edicthotbench", ED_HotBench_f);
 	Cmd_AddCommand("profile", PR_Profile_f);
 
 	Cvar_RegisterVariable(&nomonsters);
@@ -1015,4 +1172,6 @@ void PR_Init(void)
 	Cvar_RegisterVariable(&saved2);
 	Cvar_RegisterVariable(&saved3);
 	Cvar_RegisterVariable(&saved4);
+
+	ED_InitWatched();
 }
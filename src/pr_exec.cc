@@ -489,6 +489,8 @@ void PR_ExecuteProgram(func_t fnum)
 #endif
 			if (ed == (edict_t *) sv.edicts && sv.state == ss_active)
 				PR_RunError("assignment to world entity");
+			if (ED_WATCHED(b->_int))
+				ED_Dirty(ed);
 			c->_int = (byte *) ((int *) &ed->v + b->_int) - (byte *) sv.edicts;
 			break;
 
@@ -575,6 +577,7 @@ void PR_ExecuteProgram(func_t fnum)
 #else
 			ed->v.nextthink = pr_global_struct->time + 0.1;
 #endif
+			ED_Dirty(ed);
 			if (a->_float != ed->v.frame)
 			{
 				ed->v.frame = a->_float;
@@ -31,6 +31,7 @@ typedef union eval_s {
 typedef struct edict_s {
 	bool free;
 	link_t area; // linked to a division node or leaf
+	int arealeaf; // area tree leaf + 1, 0 when not in the tree
 
 	int num_leafs;
 	short leafnums[MAX_ENT_LEAFS];
@@ -45,6 +46,39 @@ typedef struct edict_s {
 #define	EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l,edict_t,area)
 #define	GETEDICTFIELDVALUE(ed, fieldoffset) (fieldoffset ? (eval_t *)((byte *)&ed->v + fieldoffset) : NULL)
 
+/*
+ * Copies of the fields the server loops test on every edict, kept apart so
+ * those loops can reject most edicts without pulling them through the cache;
+ * the ones that pass are still read from the edict. Whatever writes one
+ * of these fields marks the edict with ED_Dirty, and ED_Hot copies the
+ * fields again before handing them out.
+ */
+typedef struct {
+	vec3_t origin, mins, maxs;
+	vec3_t absmin, absmax;
+	float movetype, solid, modelindex;
+	float nextthink;
+	bool free;
+} edhot_t;
+
+extern edhot_t ed_hot[MAX_EDICTS];
+extern unsigned int ed_dirty[MAX_EDICTS / 32];
+extern unsigned int ed_changed[MAX_EDICTS / 32]; // like ed_dirty, cleared by the think scheduler
+extern bool ed_anychanged;
+extern bool ed_watched[sizeof(entvars_t) / 4]; // per int of entvars_t
+
+void ED_Refresh(int num);
+
+static inline edhot_t *ED_Hot(int num)
+{
+	if (ed_dirty[num >> 5] & (1u << (num & 31)))
+		ED_Refresh(num);
+	return &ed_hot[num];
+}
+
+/* True for QC stores that have to go through ED_Dirty */
+#define ED_WATCHED(ofs) ((unsigned int) (ofs) < sizeof(entvars_t) / 4 && ed_watched[ofs])
+
 extern int eval_gravity, eval_items2, eval_ammo_shells1, eval_ammo_nails1;
 extern int eval_ammo_lava_nails, eval_ammo_rockets1, eval_ammo_multi_rockets;
 extern int eval_ammo_cells1, eval_ammo_plasma;
@@ -87,6 +121,9 @@ void ED_ParseGlobals(const char *data);
 
 void ED_LoadFromFile(const char *data);
 
+void ED_Dirty(edict_t *ed);
+void ED_DirtyAll(void);
+
 dfunction_t *ED_FindFunction(const char *name);
 
 #define EDICT_NUM(n) (edict_t *)((byte *) sv.edicts + (n) * pr_edict_size)
@@ -14,6 +14,7 @@
 
 #include "quakedef.h"
 #include "glquake.h"
+#include "jobs.h"
 
 #define BACKFACE_EPSILON 0.01
 
@@ -35,9 +36,15 @@ cvar_t r_speeds = { "r_speeds", "0" };
 cvar_t r_shadows = { "r_shadows", "0.3", CVAR_ARCHIVE };
 cvar_t r_particles = { "r_particles", "1", CVAR_ARCHIVE };
 cvar_t r_particles_alpha = { "r_particles_alpha", "1", CVAR_ARCHIVE };
+cvar_t r_batchworld = { "r_batchworld", "1" };
+cvar_t r_queuestats = { "r_queuestats", "0" };
+cvar_t r_visthreads = { "r_visthreads", "0", CVAR_ARCHIVE };
+cvar_t r_viscache = { "r_viscache", "64" };
 
 // For draw stats
 int c_brush_polys, c_alias_polys;
+int c_draw_calls;
+int c_texture_binds, c_buffer_binds;
 
 // view origin and direction
 vec3_t r_origin, vright, vpn, vup;
@@ -48,10 +55,132 @@ refdef_t r_refdef;
 mleaf_t *r_viewleaf, *r_oldviewleaf;
 
 static mplane_t frustum[4];
-static int r_visframecount; // bumped when going to a new PVS
 
 int r_framecount;
 
+static brush_model_t *r_worldbrush; // world being traversed
+
+/*
+ * Visible node sets
+ *
+ * The nodes and leafs under which something in the PVS lies are kept as a
+ * bitset, nodes first, then leafs. The sets for the last few view leafs are
+ * cached, so moving back into one of them costs a lookup instead of a PVS
+ * decompression and a climb from every visible leaf.
+ */
+
+typedef struct
+{
+	mleaf_t *leaf; // NULL if unused
+	unsigned int lastused;
+	unsigned int *bits;
+} visset_t;
+
+static brush_model_t *visset_brush; // model the sets belong to
+static int visset_words; // per set
+static int visset_count;
+static visset_t *vissets;
+static unsigned int *visset_scratch; // for PVSs that aren't cached
+static unsigned int visset_clock;
+static int visset_hits, visset_misses;
+
+static unsigned int *r_visnodes; // set for the current view
+
+static inline bool R_NodeVisible(mnode_t *node)
+{
+	int n = node->contents < 0 ? visset_brush->numnodes + (int) ((mleaf_t *) node - visset_brush->leafs) : (int) (node - visset_brush->nodes);
+
+	return r_visnodes[n >> 5] & (1u << (n & 31));
+}
+
+static void R_FreeVisSets(void)
+{
+	free(vissets);
+	vissets = NULL;
+	visset_scratch = NULL;
+	visset_brush = NULL;
+	visset_count = 0;
+	r_visnodes = NULL;
+}
+
+/* Makes sure the sets fit brushmodel and r_viscache, starting over if not */
+static void R_CheckVisSets(brush_model_t *brushmodel)
+{
+	int count = CLAMP(1, (int) r_viscache.value, 1024);
+	unsigned int *bits;
+
+	if (visset_brush == brushmodel && visset_count == count)
+		return;
+
+	R_FreeVisSets();
+
+	visset_brush = brushmodel;
+	visset_words = (brushmodel->numnodes + brushmodel->numleafs + 1 + 31) >> 5;
+	visset_count = count;
+	visset_hits = visset_misses = 0;
+
+	vissets = (visset_t *) Q_malloc(count * sizeof(visset_t) + (count + 1) * visset_words * sizeof(unsigned int));
+	bits = (unsigned int *) (vissets + count);
+	for (int i = 0; i < count; i++, bits += visset_words)
+	{
+		vissets[i].leaf = NULL;
+		vissets[i].lastused = 0;
+		vissets[i].bits = bits;
+	}
+	visset_scratch = bits;
+}
+
+/* Flags every leaf set in vis and the nodes above it */
+static unsigned int *R_BuildVisSet(brush_model_t *brushmodel, byte *vis, unsigned int *bits)
+{
+	int n;
+
+	memset(bits, 0, visset_words * sizeof(unsigned int));
+
+	for (int i = 0; i < brushmodel->numleafs; i++)
+	{
+		if (!(vis[i >> 3] & (1 << (i & 7))))
+			continue;
+
+		n = brushmodel->numnodes + i + 1;
+		bits[n >> 5] |= 1u << (n & 31);
+
+		for (mnode_t *node = brushmodel->leafs[i + 1].parent; node; node = node->parent)
+		{
+			n = node - brushmodel->nodes;
+			if (bits[n >> 5] & (1u << (n & 31)))
+				break;
+			bits[n >> 5] |= 1u << (n & 31);
+		}
+	}
+
+	return bits;
+}
+
+/* Returns the set for the PVS of leaf, from the cache if it's there */
+static unsigned int *R_LeafVisSet(brush_model_t *brushmodel, mleaf_t *leaf)
+{
+	visset_t *set = &vissets[0];
+
+	for (int i = 0; i < visset_count; i++)
+	{
+		if (vissets[i].leaf == leaf)
+		{
+			vissets[i].lastused = ++visset_clock;
+			visset_hits++;
+			return vissets[i].bits;
+		}
+		if (vissets[i].lastused < set->lastused)
+			set = &vissets[i];
+	}
+
+	// replace the least recently used one
+	set->leaf = leaf;
+	set->lastused = ++visset_clock;
+	visset_misses++;
+	return R_BuildVisSet(brushmodel, Mod_LeafPVS(leaf, brushmodel), set->bits);
+}
+
 static void R_RecursiveWorldNode(mnode_t *node)
 {
 	int c, side;
@@ -63,7 +192,7 @@ static void R_RecursiveWorldNode(mnode_t *node)
 	if (node->contents == CONTENTS_SOLID)
 		return; // solid
 
-	if (node->visframe != r_visframecount)
+	if (!R_NodeVisible(node))
 		return;
 
 	if (R_CullBox(node->minmaxs, node->minmaxs + 3))
@@ -127,7 +256,7 @@ static void R_RecursiveWorldNode(mnode_t *node)
 		else if (dot > BACKFACE_EPSILON)
 			side = 0;
 
-		msurface_t *surf = cl.worldmodel->brushmodel->surfaces + node->firstsurface;
+		msurface_t *surf = r_worldbrush->surfaces + node->firstsurface;
 		for (; c; c--, surf++)
 		{
 			if (surf->visframe != r_framecount)
@@ -148,8 +277,7 @@ static void R_RecursiveWorldNode(mnode_t *node)
 
 static void R_MarkLeaves(void)
 {
-	byte *vis, solid[4096];
-	mnode_t *node;
+	byte solid[4096];
 	extern cvar_t gl_nearwater_fix;
 	bool nearwaterportal = false;
 
@@ -169,176 +297,565 @@ static void R_MarkLeaves(void)
 		}
 	}
 
-	if ((r_oldviewleaf == r_viewleaf) && !r_novis.value && !nearwaterportal)
+	R_CheckVisSets(cl.worldmodel->brushmodel);
+
+	if ((r_oldviewleaf == r_viewleaf) && r_visnodes && !r_novis.value && !nearwaterportal)
 		return;
 
-	r_visframecount++;
 	r_oldviewleaf = r_viewleaf;
 
 	if (r_novis.value)
 	{
-		vis = solid;
 		memset(solid, 0xff, (cl.worldmodel->brushmodel->numleafs + 7) >> 3);
+		r_visnodes = R_BuildVisSet(cl.worldmodel->brushmodel, solid, visset_scratch);
 	}
 	else if (nearwaterportal)
 	{
-		vis = SV_FatPVS(r_origin, cl.worldmodel);
+		r_visnodes = R_BuildVisSet(cl.worldmodel->brushmodel, SV_FatPVS(r_origin, cl.worldmodel), visset_scratch);
 	}
 	else
 	{
-		vis = Mod_LeafPVS(r_viewleaf, cl.worldmodel->brushmodel);
+		r_visnodes = R_LeafVisSet(cl.worldmodel->brushmodel, r_viewleaf);
+	}
+}
+
+/*
+ * Threaded world traversal
+ *
+ * The visible part of the tree is cut into subtrees, biggest first, which
+ * become the jobs. The first pass culls each subtree and marks the surfaces
+ * of the leaves that survive. Surfaces are shared between leaves of different
+ * subtrees, so only once every job is done does a second pass go over the
+ * nodes each job kept and bucket their marked, front facing surfaces by
+ * texture. The buckets are linked into the texture chains and the entity
+ * fragments stored in job order, so the result doesn't depend on the number
+ * of threads. Everything a job writes is its own slice of arrays sized from
+ * subtree totals taken once per map.
+ */
+
+#define	MAX_VIS_JOBS	64
+
+typedef struct
+{
+	mnode_t *root;
+
+	mnode_t **nodes; // nodes with surfaces, front to back
+	int numnodes;
+
+	mleaf_t **leafs; // leafs with entity fragments
+	int numleafs;
+
+	msurface_t **heads, **tails; // texture buckets
+	int numsurfs;
+} visjob_t;
+
+static brush_model_t *vis_brush; // model the tables below belong to
+static int *vis_subnodes, *vis_subleafs; // subtree totals per node
+static int *vis_texnum; // texture number per texinfo, -1 if not in the model's textures
+static mnode_t **vis_nodes;
+static mleaf_t **vis_leafs;
+static msurface_t **vis_buckets;
+
+static visjob_t vis_jobs[MAX_VIS_JOBS + 1]; // one past the last holds the nodes above the cut
+static int vis_numjobs;
+
+static inline int R_SubtreeNodes(mnode_t *node)
+{
+	return node->contents < 0 ? 0 : vis_subnodes[node - vis_brush->nodes];
+}
+
+/* The solid leaf is shared by most nodes but never visited, so it doesn't count */
+static inline int R_SubtreeLeafs(mnode_t *node)
+{
+	if (node->contents < 0)
+		return node->contents != CONTENTS_SOLID;
+	return vis_subleafs[node - vis_brush->nodes];
+}
+
+static void R_CountSubtree(mnode_t *node)
+{
+	int n = node - vis_brush->nodes;
+
+	vis_subnodes[n] = 1;
+	vis_subleafs[n] = 0;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (node->children[i]->contents >= 0)
+			R_CountSubtree(node->children[i]);
+		vis_subnodes[n] += R_SubtreeNodes(node->children[i]);
+		vis_subleafs[n] += R_SubtreeLeafs(node->children[i]);
 	}
+}
+
+static void R_FreeVisTables(void)
+{
+	free(vis_subnodes);
+	free(vis_subleafs);
+	free(vis_texnum);
+	free(vis_nodes);
+	free(vis_leafs);
+	free(vis_buckets);
+	vis_subnodes = vis_subleafs = vis_texnum = NULL;
+	vis_nodes = NULL;
+	vis_leafs = NULL;
+	vis_buckets = NULL;
+	vis_brush = NULL;
+}
+
+static void R_BuildVisTables(brush_model_t *brushmodel)
+{
+	R_FreeVisTables();
+
+	vis_brush = brushmodel;
+	vis_subnodes = (int *) Q_malloc(brushmodel->numnodes * sizeof(int));
+	vis_subleafs = (int *) Q_malloc(brushmodel->numnodes * sizeof(int));
+	vis_nodes = (mnode_t **) Q_malloc(brushmodel->numnodes * sizeof(mnode_t *));
+	vis_leafs = (mleaf_t **) Q_malloc((brushmodel->numleafs + 1) * sizeof(mleaf_t *));
+	vis_buckets = (msurface_t **) Q_malloc((MAX_VIS_JOBS + 1) * 2 * (brushmodel->numtextures + 1) * sizeof(msurface_t *));
 
-	for (int i = 0; i < cl.worldmodel->brushmodel->numleafs; i++)
+	vis_texnum = (int *) Q_malloc(brushmodel->numtexinfo * sizeof(int));
+	for (int i = 0; i < brushmodel->numtexinfo; i++)
 	{
-		if (vis[i >> 3] & (1 << (i & 7)))
+		vis_texnum[i] = -1; // r_notexture_mip
+		for (int j = 0; j < brushmodel->numtextures; j++)
 		{
-			node = (mnode_t *) &cl.worldmodel->brushmodel->leafs[i + 1];
-			do
+			if (brushmodel->textures[j] == brushmodel->texinfo[i].texture)
 			{
-				if (node->visframe == r_visframecount)
-					break;
-				node->visframe = r_visframecount;
-				node = node->parent;
-			} while (node);
+				vis_texnum[i] = j;
+				break;
+			}
 		}
 	}
+
+	R_CountSubtree(brushmodel->nodes);
 }
 
-static void R_DrawWorld(void)
+static inline bool R_VisitNode(mnode_t *node)
 {
-	R_ClearLightmapPolys();
+	return node->contents != CONTENTS_SOLID && R_NodeVisible(node) && !R_CullBox(node->minmaxs, node->minmaxs + 3);
+}
 
-	R_MarkLeaves();
+static inline double R_NodeDot(mnode_t *node)
+{
+	mplane_t *plane = node->plane;
 
-	R_RecursiveWorldNode(cl.worldmodel->brushmodel->nodes);
+	if (plane->type < 3)
+		return r_refdef.vieworg[plane->type] - plane->dist;
+	return DotProduct(r_refdef.vieworg, plane->normal) - plane->dist;
+}
 
-	R_DrawSurfaces(cl.worldmodel->brushmodel);
+/* Cuts the visible tree into at most maxjobs subtrees, biggest first */
+static void R_SplitWorld(brush_model_t *brushmodel, int maxjobs)
+{
+	visjob_t upper;
+	mnode_t *node;
+	int nodes, leafs, best;
 
-//	R_BlendLightmaps();
+	upper.nodes = vis_nodes;
+	upper.numnodes = 0;
+	upper.numleafs = 0;
+
+	vis_numjobs = 0;
+	if (R_VisitNode(brushmodel->nodes))
+		vis_jobs[vis_numjobs++].root = brushmodel->nodes;
+
+	while (vis_numjobs < maxjobs)
+	{
+		best = -1;
+		for (int i = 0; i < vis_numjobs; i++)
+			if (R_SubtreeNodes(vis_jobs[i].root) && (best < 0 || R_SubtreeNodes(vis_jobs[i].root) > R_SubtreeNodes(vis_jobs[best].root)))
+				best = i;
+		if (best < 0)
+			break; // nothing but leafs left
+
+		node = vis_jobs[best].root;
+		vis_jobs[best] = vis_jobs[--vis_numjobs];
+
+		if (node->numsurfaces)
+			upper.nodes[upper.numnodes++] = node;
+
+		for (int i = 0; i < 2; i++)
+			if (R_VisitNode(node->children[i]))
+				vis_jobs[vis_numjobs++].root = node->children[i];
+	}
+
+	// hand out slices, the nodes above the cut come first
+	nodes = upper.numnodes;
+	leafs = 0;
+	for (int i = 0; i < vis_numjobs; i++)
+	{
+		vis_jobs[i].nodes = vis_nodes + nodes;
+		vis_jobs[i].leafs = vis_leafs + leafs;
+		nodes += R_SubtreeNodes(vis_jobs[i].root);
+		leafs += R_SubtreeLeafs(vis_jobs[i].root);
+	}
+	vis_jobs[vis_numjobs] = upper;
 }
 
-/* Returns true if the box is completely outside the frustum */
-bool R_CullBox(vec3_t mins, vec3_t maxs)
+static void R_VisMarkNode(visjob_t *job, mnode_t *node)
 {
-	int i;
+	if (!R_VisitNode(node))
+		return;
 
-	for (i = 0; i < 4; i++)
-		if (BoxOnPlaneSide(mins, maxs, &frustum[i]) == 2)
-			return true;
+	if (node->contents < 0)
+	{
+		mleaf_t *pleaf = (mleaf_t *) node;
+		msurface_t **mark = pleaf->firstmarksurface;
 
-	return false;
+		// other jobs may mark the same surfaces, with the same value
+		for (int c = pleaf->nummarksurfaces; c; c--, mark++)
+			__atomic_store_n(&(*mark)->visframe, r_framecount, __ATOMIC_RELAXED);
+
+		if (pleaf->efrags)
+			job->leafs[job->numleafs++] = pleaf;
+		return;
+	}
+
+	int side = R_NodeDot(node) >= 0 ? 0 : 1;
+
+	R_VisMarkNode(job, node->children[side]);
+	if (node->numsurfaces)
+		job->nodes[job->numnodes++] = node;
+	R_VisMarkNode(job, node->children[!side]);
 }
 
-/* Returns true if the box is completely outside the frustum */
-static bool R_CullBoxA(const vec3_t emins, const vec3_t emaxs)
+static void R_VisMarkJob(void *data, int j)
 {
-	int i;
-	mplane_t *p;
-	for (i = 0; i < 4; i++)
+	visjob_t *job = &vis_jobs[j];
+
+	job->numnodes = 0;
+	job->numleafs = 0;
+	R_VisMarkNode(job, job->root);
+}
+
+static void R_VisBucketJob(void *data, int j)
+{
+	visjob_t *job = &vis_jobs[j];
+	int numtextures = vis_brush->numtextures;
+
+	// the last bucket holds surfaces whose texture isn't in the model
+	job->heads = vis_buckets + j * 2 * (numtextures + 1);
+	job->tails = job->heads + numtextures + 1;
+	job->numsurfs = 0;
+	memset(job->heads, 0, (numtextures + 1) * sizeof(msurface_t *));
+
+	for (int i = 0; i < job->numnodes; i++)
 	{
-		p = frustum + i;
-		switch (p->signbits)
+		mnode_t *node = job->nodes[i];
+		double dot = R_NodeDot(node);
+		msurface_t *surf = vis_brush->surfaces + node->firstsurface;
+
+		for (int c = node->numsurfaces; c; c--, surf++)
 		{
-		default:
-		case 0:
-			if (p->normal[0] * emaxs[0] + p->normal[1] * emaxs[1] + p->normal[2] * emaxs[2] < p->dist)
-				return true;
-			break;
-		case 1:
-			if (p->normal[0] * emins[0] + p->normal[1] * emaxs[1] + p->normal[2] * emaxs[2] < p->dist)
-				return true;
-			break;
-		case 2:
-			if (p->normal[0] * emaxs[0] + p->normal[1] * emins[1] + p->normal[2] * emaxs[2] < p->dist)
-				return true;
-			break;
-		case 3:
-			if (p->normal[0] * emins[0] + p->normal[1] * emins[1] + p->normal[2] * emaxs[2] < p->dist)
-				return true;
-			break;
-		case 4:
-			if (p->normal[0] * emaxs[0] + p->normal[1] * emaxs[1] + p->normal[2] * emins[2] < p->dist)
-				return true;
-			break;
-		case 5:
-			if (p->normal[0] * emins[0] + p->normal[1] * emaxs[1] + p->normal[2] * emins[2] < p->dist)
-				return true;
-			break;
-		case 6:
-			if (p->normal[0] * emaxs[0] + p->normal[1] * emins[1] + p->normal[2] * emins[2] < p->dist)
-				return true;
-			break;
-		case 7:
-			if (p->normal[0] * emins[0] + p->normal[1] * emins[1] + p->normal[2] * emins[2] < p->dist)
-				return true;
-			break;
+			if (surf->visframe != r_framecount)
+				continue;
+
+			// don't backface underwater surfaces, because they warp
+			if ((!(surf->flags & SURF_UNDERWATER) || !r_waterwarp.value) && ((dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)))
+				continue; // wrong side
+
+			int t = vis_texnum[surf->texinfo - vis_brush->texinfo];
+			if (t < 0)
+				t = numtextures;
+			surf->texturechain = NULL;
+			if (job->heads[t])
+				job->tails[t]->texturechain = surf;
+			else
+				job->heads[t] = surf;
+			job->tails[t] = surf;
+			job->numsurfs++;
 		}
 	}
-	return false;
 }
 
-/* Returns true if the sphere is completely outside the frustum */
-#define PlaneDiff(point, plane) (((plane)->type < 3 ? (point)[(plane)->type] : DotProduct((point), (plane)->normal)) - (plane)->dist)
-static bool R_CullSphere(const vec3_t centre, const float radius)
+/*
+ * Same output as R_RecursiveWorldNode, with the traversal spread over
+ * numthreads threads. Entity fragments are only stored if efrags is set.
+ */
+static void R_ThreadedWorldNode(brush_model_t *brushmodel, int numthreads, bool efrags)
 {
-	int i;
-	mplane_t *p;
+	if (vis_brush != brushmodel)
+		R_BuildVisTables(brushmodel);
+
+	R_SplitWorld(brushmodel, min(numthreads * 4, MAX_VIS_JOBS));
+
+	Jobs_Run(R_VisMarkJob, NULL, vis_numjobs, numthreads);
+	Jobs_Run(R_VisBucketJob, NULL, vis_numjobs + 1, numthreads);
 
-	for (i = 0, p = frustum; i < 4; i++, p++)
+	// link the buckets in job order, in front of anything already chained
+	for (int t = 0; t < brushmodel->numtextures; t++)
 	{
-		if (PlaneDiff(centre, p) <= -radius)
-			return true;
+		texture_t *texture = brushmodel->textures[t];
+		msurface_t *chain;
+
+		if (!texture)
+			continue;
+
+		chain = texture->texturechain;
+		for (int j = vis_numjobs; j >= 0; j--)
+		{
+			if (!vis_jobs[j].heads[t])
+				continue;
+			vis_jobs[j].tails[t]->texturechain = chain;
+			chain = vis_jobs[j].heads[t];
+		}
+		texture->texturechain = chain;
 	}
 
-	return false;
+	// chain the rest on their own texture, as R_RecursiveWorldNode does
+	for (int j = 0; j <= vis_numjobs; j++)
+	{
+		msurface_t *surf, *next;
+
+		for (surf = vis_jobs[j].heads[brushmodel->numtextures]; surf; surf = next)
+		{
+			next = surf->texturechain;
+			surf->texturechain = surf->texinfo->texture->texturechain;
+			surf->texinfo->texture->texturechain = surf;
+		}
+	}
+
+	if (efrags)
+	{
+		for (int j = 0; j < vis_numjobs; j++)
+			for (int i = 0; i < vis_jobs[j].numleafs; i++)
+				R_StoreEfrags(&vis_jobs[j].leafs[i]->efrags);
+	}
 }
 
-bool R_CullForEntity(const entity_t *ent/*, vec3_t returned_center*/)
+static void R_DrawWorld(void)
 {
-	vec3_t mins, maxs;
+	R_ClearLightmapPolys();
 
-	if (ent->angles[0] || ent->angles[1] || ent->angles[2])
-		return R_CullSphere(ent->origin, ent->model->radius); // Angles turned; do sphere cull test
+	R_MarkLeaves();
 
-	// Angles all 0; do box cull test
-	VectorAdd(ent->origin, ent->model->mins, mins); // Add entity origin and model mins to calc mins
-	VectorAdd(ent->origin, ent->model->maxs, maxs); // Add entity origin and model maxs to calc maxs
+	r_worldbrush = cl.worldmodel->brushmodel;
+	if (r_visthreads.value > 0)
+		R_ThreadedWorldNode(r_worldbrush, min((int) r_visthreads.value, MAX_JOB_THREADS), true);
+	else
+		R_RecursiveWorldNode(r_worldbrush->nodes);
 
-//	if (returned_center)
-//		LerpVector (mins, maxs, 0.5, returned_center);
+	R_DrawSurfaces(cl.worldmodel->brushmodel);
+
+//	R_BlendLightmaps();
+}
 
-//	if (R_CullBox (mins, maxs))
-//		return true;
+/*
+ * The frustum planes are also kept one per lane, so a box is tested against
+ * all four at once. For each plane the corner of the box furthest along its
+ * normal is picked, a box is outside if that corner is behind any plane.
+ */
 
-	if (R_CullBoxA(mins, maxs))
-		return true;
+static vec4f_t frustum_x, frustum_y, frustum_z, frustum_dist;
+static vec4i_t frustum_negx, frustum_negy, frustum_negz; // all ones where the normal is negative
 
-	return false;
+static void R_LoadFrustum(void)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		frustum_x[i] = frustum[i].normal[0];
+		frustum_y[i] = frustum[i].normal[1];
+		frustum_z[i] = frustum[i].normal[2];
+		frustum_dist[i] = frustum[i].dist;
+		frustum_negx[i] = frustum[i].normal[0] < 0 ? -1 : 0;
+		frustum_negy[i] = frustum[i].normal[1] < 0 ? -1 : 0;
+		frustum_negz[i] = frustum[i].normal[2] < 0 ? -1 : 0;
+	}
+}
+
+static inline vec4f_t V4_Select(vec4i_t mask, vec4f_t a, vec4f_t b)
+{
+	return (vec4f_t) (((vec4i_t) a & mask) | ((vec4i_t) b & ~mask));
+}
+
+/* Returns true if the box is completely outside the frustum */
+bool R_CullBox(vec3_t mins, vec3_t maxs)
+{
+	vec4f_t x = V4_Select(frustum_negx, V4_Set(mins[0]), V4_Set(maxs[0]));
+	vec4f_t y = V4_Select(frustum_negy, V4_Set(mins[1]), V4_Set(maxs[1]));
+	vec4f_t z = V4_Select(frustum_negz, V4_Set(mins[2]), V4_Set(maxs[2]));
+	vec4i_t out = frustum_x * x + frustum_y * y + frustum_z * z < frustum_dist;
+
+	return (out[0] | out[1] | out[2] | out[3]) != 0;
+}
+
+/*
+ * Sets culled[i] if the box from mins[i] to maxs[i] is completely outside
+ * the frustum, four boxes at a time with a box per lane. Returns how many
+ * were culled.
+ */
+int R_CullBoxes(const vec3_t *mins, const vec3_t *maxs, bool *culled, int count)
+{
+	int numculled = 0;
+
+	for (int i = 0; i < count; i += 4)
+	{
+		vec4f_t minx, miny, minz, maxx, maxy, maxz;
+		vec4i_t out = { 0, 0, 0, 0 };
+
+		// repeat the last box to fill the tail
+		for (int j = 0; j < 4; j++)
+		{
+			int k = min(i + j, count - 1);
+			minx[j] = mins[k][0];
+			miny[j] = mins[k][1];
+			minz[j] = mins[k][2];
+			maxx[j] = maxs[k][0];
+			maxy[j] = maxs[k][1];
+			maxz[j] = maxs[k][2];
+		}
+
+		for (int p = 0; p < 4; p++)
+		{
+			vec4f_t x = frustum[p].normal[0] < 0 ? minx : maxx;
+			vec4f_t y = frustum[p].normal[1] < 0 ? miny : maxy;
+			vec4f_t z = frustum[p].normal[2] < 0 ? minz : maxz;
+
+			out |= V4_Set(frustum[p].normal[0]) * x + V4_Set(frustum[p].normal[1]) * y + V4_Set(frustum[p].normal[2]) * z < V4_Set(frustum[p].dist);
+		}
+
+		for (int j = 0; j < 4 && i + j < count; j++)
+		{
+			culled[i + j] = out[j] != 0;
+			numculled += culled[i + j];
+		}
+	}
+
+	return numculled;
+}
+
+/* Box around everything ent can cover, rotated models get a cube around their radius */
+void R_EntityBounds(const entity_t *ent, vec3_t mins, vec3_t maxs)
+{
+	if (ent->angles[0] || ent->angles[1] || ent->angles[2])
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			mins[i] = ent->origin[i] - ent->model->radius;
+			maxs[i] = ent->origin[i] + ent->model->radius;
+		}
+	}
+	else
+	{
+		VectorAdd(ent->origin, ent->model->mins, mins);
+		VectorAdd(ent->origin, ent->model->maxs, maxs);
+	}
+}
+
+/*
+ * Visible entities are drawn through a queue sorted by what they bind:
+ * opaque ones first, then brush, alias and sprite models, then by model
+ * and skin. Runs of the same monster or gib share their buffers and
+ * textures, and sprites, which blend, come after everything solid.
+ */
+
+typedef struct
+{
+	int translucent;
+	int order; // by model type
+	model_t *model;
+	gltexture_t *skin;
+	entity_t *entity;
+} renderqueue_t;
+
+static renderqueue_t r_queue[MAX_VISEDICTS];
+static vec3_t r_cullmins[MAX_VISEDICTS], r_cullmaxs[MAX_VISEDICTS];
+static bool r_culled[MAX_VISEDICTS];
+
+static int R_QueueCompare(const void *a, const void *b)
+{
+	const renderqueue_t *qa = (const renderqueue_t *) a;
+	const renderqueue_t *qb = (const renderqueue_t *) b;
+
+	if (qa->translucent != qb->translucent)
+		return qa->translucent - qb->translucent;
+	if (qa->order != qb->order)
+		return qa->order - qb->order;
+	if (qa->model != qb->model)
+		return qa->model < qb->model ? -1 : 1;
+	if (qa->skin != qb->skin)
+		return qa->skin < qb->skin ? -1 : 1;
+	return qa->entity < qb->entity ? -1 : qa->entity > qb->entity; // keep the order stable
 }
 
 static void R_DrawEntitiesOnList(void)
 {
+	int numqueued = 0;
+	int drawcalls = c_draw_calls, texturebinds = c_texture_binds, bufferbinds = c_buffer_binds;
+
 	if (!r_drawentities.value)
 		return;
 
+	// sprites face the view whatever their bounds say, so only models are culled
+	int numcull = 0;
 	for (int i = 0; i < cl_numvisedicts; i++)
 	{
 		entity_t *entity = cl_visedicts[i];
 
+		if (entity->model->type == mod_sprite)
+			continue;
+		R_EntityBounds(entity, r_cullmins[numcull], r_cullmaxs[numcull]);
+		numcull++;
+	}
+	R_CullBoxes(r_cullmins, r_cullmaxs, r_culled, numcull);
+
+	for (int i = 0, j = 0; i < cl_numvisedicts; i++)
+	{
+		entity_t *entity = cl_visedicts[i];
+
+		if (entity->model->type != mod_sprite && r_culled[j++])
+			continue;
+
+		renderqueue_t *q = &r_queue[numqueued++];
+
+		q->translucent = entity->alpha > 0 && entity->alpha < 1;
+		q->model = entity->model;
+		q->entity = entity;
+		q->skin = NULL;
+
+		switch (entity->model->type)
+		{
+			case mod_brush:
+				q->order = 0;
+				break;
+			case mod_alias:
+				q->order = 1;
+				q->skin = R_AliasSkin(entity, NULL);
+				break;
+			case mod_sprite:
+				q->order = 2;
+				q->translucent = true;
+				break;
+		}
+	}
+
+	qsort(r_queue, numqueued, sizeof(*r_queue), R_QueueCompare);
+
+	for (int i = 0; i < numqueued; i++)
+	{
+		entity_t *entity = r_queue[i].entity;
+
 		switch (entity->model->type)
 		{
 			case mod_alias:
 				R_DrawAliasModel(entity);
 				break;
 			case mod_brush:
+				R_EndAliasModels();
 				R_DrawBrushModel(entity);
 				break;
 			case mod_sprite:
+				R_EndAliasModels();
 				R_DrawSpriteModel(entity);
 				break;
 		}
 	}
+	R_EndAliasModels();
+
+	if (r_queuestats.value)
+		Con_Printf("%3i entities %3i draws %3i texture binds %3i buffer binds\n", numqueued,
+			   c_draw_calls - drawcalls, c_texture_binds - texturebinds, c_buffer_binds - bufferbinds);
 }
 
 static void R_DrawViewModel(void)
@@ -355,6 +872,7 @@ static void R_DrawViewModel(void)
 		return;
 
 	R_DrawAliasModel(entity);
+	R_EndAliasModels();
 }
 
 static int SignbitsForPlane(mplane_t *out)
@@ -405,6 +923,8 @@ static void R_SetFrustum(void)
 		frustum[i].dist = DotProduct(r_origin, frustum[i].normal);
 		frustum[i].signbits = SignbitsForPlane(&frustum[i]);
 	}
+
+	R_LoadFrustum();
 }
 
 static void R_SetupFrame(void)
@@ -441,6 +961,9 @@ void R_NewMap(void)
 
 	r_viewleaf = NULL;
 
+	R_FreeVisSets();
+	R_FreeVisTables();
+
 	GL_BuildLightmaps();
 
 	// identify sky texture
@@ -474,6 +997,7 @@ void R_RenderView(void)
 		c_brush_polys = 0;
 		c_alias_polys = 0;
 	}
+	c_draw_calls = 0;
 
 	R_Clear();
 
@@ -493,7 +1017,7 @@ void R_RenderView(void)
 	{
 		glFinish();
 		time2 = Sys_DoubleTime();
-		Con_Printf("%3i ms  %4i wpoly %4i epoly\n", (int) ((time2 - time1) * 1000), c_brush_polys, c_alias_polys);
+		Con_Printf("%3i ms  %4i wpoly %4i epoly %4i draws\n", (int) ((time2 - time1) * 1000), c_brush_polys, c_alias_polys, c_draw_calls);
 	}
 }
 
@@ -523,9 +1047,291 @@ static void R_TimeRefresh_f(void)
 	GL_EndRendering();
 }
 
+/* Sets up the view for one benchmark viewpoint, four yaws per sampled leaf */
+static bool R_VisBenchView(brush_model_t *brushmodel, int view, int step)
+{
+	mleaf_t *leaf = brushmodel->leafs + 1 + (view / 4) * step;
+
+	if (leaf->contents == CONTENTS_SOLID)
+		return false;
+
+	for (int i = 0; i < 3; i++)
+		r_refdef.vieworg[i] = (leaf->minmaxs[i] + leaf->minmaxs[3 + i]) * 0.5f;
+	r_refdef.viewangles[0] = 0;
+	r_refdef.viewangles[1] = (view & 3) * 90;
+	r_refdef.viewangles[2] = 0;
+	r_refdef.fov_x = r_refdef.fov_y = 90;
+
+	VectorCopy(r_refdef.vieworg, r_origin);
+	AngleVectors(r_refdef.viewangles, vpn, vright, vup);
+	R_SetFrustum();
+
+	r_viewleaf = Mod_PointInLeaf(r_origin, brushmodel);
+	r_visnodes = R_LeafVisSet(brushmodel, r_viewleaf);
+	r_framecount++;
+
+	return true;
+}
+
+/* Empties the texture chains, flagging the surfaces that were in them if seen is set */
+static int R_VisBenchClear(brush_model_t *brushmodel, byte *seen, int bit)
+{
+	int count = 0;
+
+	for (int i = 0; i < brushmodel->numtextures; i++)
+	{
+		texture_t *texture = brushmodel->textures[i];
+
+		if (!texture)
+			continue;
+		if (seen)
+		{
+			for (msurface_t *surf = texture->texturechain; surf; surf = surf->texturechain, count++)
+				seen[surf - brushmodel->surfaces] |= bit;
+		}
+		texture->texturechain = NULL;
+	}
+
+	return count;
+}
+
+/*
+ * Runs only the world visibility phase from a spread of viewpoints, serial
+ * and threaded, and checks both pick the same surfaces. Works without video
+ * too, a dedicated server uses its own map.
+ */
+static void R_VisBench_f(void)
+{
+	brush_model_t *brushmodel;
+	int numthreads, numviews, step, views, surfs, serialdiffs, threaddiffs;
+	double start, times[3];
+	byte *seen;
+
+	if (cls.state == ca_connected && cl.worldmodel)
+		brushmodel = cl.worldmodel->brushmodel;
+	else if (sv.active && sv.worldmodel)
+		brushmodel = sv.worldmodel->brushmodel;
+	else
+	{
+		Con_Printf("r_visbench: no map loaded\n");
+		return;
+	}
+
+	numthreads = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : Jobs_NumCPUs();
+	numthreads = CLAMP(1, numthreads, MAX_JOB_THREADS);
+
+	// keep the view of the current frame
+	refdef_t oldrefdef = r_refdef;
+	vec3_t oldorigin, oldvpn, oldvright, oldvup;
+	mplane_t oldfrustum[4];
+	mleaf_t *oldviewleaf = r_viewleaf;
+	brush_model_t *oldworldbrush = r_worldbrush;
+	int oldnumvisedicts = cl_numvisedicts;
+	VectorCopy(r_origin, oldorigin);
+	VectorCopy(vpn, oldvpn);
+	VectorCopy(vright, oldvright);
+	VectorCopy(vup, oldvup);
+	memcpy(oldfrustum, frustum, sizeof(frustum));
+
+	R_FreeVisSets();
+	R_CheckVisSets(brushmodel);
+	R_BuildVisTables(brushmodel);
+	r_worldbrush = brushmodel;
+
+	step = max(1, brushmodel->numleafs / 128);
+	numviews = (brushmodel->numleafs / step) * 4;
+	seen = (byte *) Q_malloc(brushmodel->numsurfaces);
+
+	// check the threaded traversal against the serial one, and against itself
+	views = surfs = serialdiffs = threaddiffs = 0;
+	for (int v = 0; v < numviews; v++)
+	{
+		if (!R_VisBenchView(brushmodel, v, step))
+			continue;
+
+		memset(seen, 0, brushmodel->numsurfaces);
+		R_RecursiveWorldNode(brushmodel->nodes);
+		surfs += R_VisBenchClear(brushmodel, seen, 1);
+		R_ThreadedWorldNode(brushmodel, 1, true);
+		R_VisBenchClear(brushmodel, seen, 2);
+		R_ThreadedWorldNode(brushmodel, numthreads, true);
+		R_VisBenchClear(brushmodel, seen, 4);
+		cl_numvisedicts = oldnumvisedicts;
+
+		for (int i = 0; i < brushmodel->numsurfaces; i++)
+		{
+			if (!seen[i])
+				continue;
+			serialdiffs += ((seen[i] >> 2) ^ seen[i]) & 1;
+			threaddiffs += ((seen[i] >> 1) ^ (seen[i] >> 2)) & 1;
+		}
+		views++;
+	}
+
+	free(seen);
+
+	// time setup alone, then each traversal on top of it
+	for (int pass = 0; pass < 3; pass++)
+	{
+		start = Sys_DoubleTime();
+		for (int rep = 0; rep < 8; rep++)
+		{
+			for (int v = 0; v < numviews; v++)
+			{
+				if (!R_VisBenchView(brushmodel, v, step))
+					continue;
+				if (pass == 1)
+					R_RecursiveWorldNode(brushmodel->nodes);
+				else if (pass == 2)
+					R_ThreadedWorldNode(brushmodel, numthreads, true);
+				R_VisBenchClear(brushmodel, NULL, 0);
+				cl_numvisedicts = oldnumvisedicts;
+			}
+		}
+		times[pass] = Sys_DoubleTime() - start;
+	}
+
+	r_refdef = oldrefdef;
+	VectorCopy(oldorigin, r_origin);
+	VectorCopy(oldvpn, vpn);
+	VectorCopy(oldvright, vright);
+	VectorCopy(oldvup, vup);
+	memcpy(frustum, oldfrustum, sizeof(frustum));
+	R_LoadFrustum();
+	r_viewleaf = oldviewleaf;
+	r_oldviewleaf = NULL; // pick the set for the view leaf again
+	r_worldbrush = oldworldbrush;
+
+	if (!views)
+	{
+		Con_Printf("r_visbench: no open leafs\n");
+		return;
+	}
+
+	double serial = max(times[1] - times[0], 0.0) * 1000 / (views * 8);
+	double threaded = max(times[2] - times[0], 0.0) * 1000 / (views * 8);
+
+	Con_Printf("%i views, %i surfaces per view\n", views, surfs / views);
+	Con_Printf("serial %.3f ms, %i threads %.3f ms per view (%.2fx)\n", serial, numthreads, threaded, threaded > 0 ? serial / threaded : 0.0);
+	Con_Printf("%i surfaces differ from serial, %i differ between 1 and %i threads\n", serialdiffs, threaddiffs, numthreads);
+	Con_Printf("%i visible node sets cached, %i hits, %i misses\n", visset_count, visset_hits, visset_misses);
+}
+
+/*
+ * Times BoxOnPlaneSide against the four wide box tests on random boxes
+ * around a fixed view, after checking they agree.
+ */
+#define	CULLBENCH_BOXES	4096
+#define	CULLBENCH_REPS	256
+
+static volatile int cullbench_sink; // keeps the timed loops from being thrown away
+
+static bool R_CullBoxPlanes(vec3_t mins, vec3_t maxs)
+{
+	for (int i = 0; i < 4; i++)
+		if (BoxOnPlaneSide(mins, maxs, &frustum[i]) == 2)
+			return true;
+
+	return false;
+}
+
+static void R_CullBench_f(void)
+{
+	static vec3_t mins[CULLBENCH_BOXES], maxs[CULLBENCH_BOXES];
+	static bool culled[CULLBENCH_BOXES];
+	int numculled, singlediffs, batchdiffs, sum;
+	double start, times[3];
+
+	// keep the view of the current frame
+	refdef_t oldrefdef = r_refdef;
+	vec3_t oldorigin, oldvpn, oldvright, oldvup;
+	mplane_t oldfrustum[4];
+	VectorCopy(r_origin, oldorigin);
+	VectorCopy(vpn, oldvpn);
+	VectorCopy(vright, oldvright);
+	VectorCopy(vup, oldvup);
+	memcpy(oldfrustum, frustum, sizeof(frustum));
+
+	VectorClear(r_origin);
+	r_refdef.viewangles[0] = 20;
+	r_refdef.viewangles[1] = 30;
+	r_refdef.viewangles[2] = 0;
+	r_refdef.fov_x = r_refdef.fov_y = 90;
+	AngleVectors(r_refdef.viewangles, vpn, vright, vup);
+	R_SetFrustum();
+
+	srand(1);
+	for (int i = 0; i < CULLBENCH_BOXES; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			float centre = (rand() % 4096) - 2048;
+			float size = 1 + rand() % 128;
+			mins[i][j] = centre - size;
+			maxs[i][j] = centre + size;
+		}
+	}
+
+	R_CullBoxes(mins, maxs, culled, CULLBENCH_BOXES);
+	numculled = singlediffs = batchdiffs = 0;
+	for (int i = 0; i < CULLBENCH_BOXES; i++)
+	{
+		bool ref = R_CullBoxPlanes(mins[i], maxs[i]);
+		numculled += ref;
+		singlediffs += R_CullBox(mins[i], maxs[i]) != ref;
+		batchdiffs += culled[i] != ref;
+	}
+
+	sum = 0;
+	for (int pass = 0; pass < 3; pass++)
+	{
+		start = Sys_DoubleTime();
+		for (int rep = 0; rep < CULLBENCH_REPS; rep++)
+		{
+			if (pass == 0)
+			{
+				for (int i = 0; i < CULLBENCH_BOXES; i++)
+					sum += R_CullBoxPlanes(mins[i], maxs[i]);
+			}
+			else if (pass == 1)
+			{
+				for (int i = 0; i < CULLBENCH_BOXES; i++)
+					sum += R_CullBox(mins[i], maxs[i]);
+			}
+			else
+			{
+				sum += R_CullBoxes(mins, maxs, culled, CULLBENCH_BOXES);
+			}
+		}
+		times[pass] = (Sys_DoubleTime() - start) * 1e9 / (CULLBENCH_REPS * CULLBENCH_BOXES);
+	}
+
+	r_refdef = oldrefdef;
+	VectorCopy(oldorigin, r_origin);
+	VectorCopy(oldvpn, vpn);
+	VectorCopy(oldvright, vright);
+	VectorCopy(oldvup, vup);
+	memcpy(frustum, oldfrustum, sizeof(frustum));
+	R_LoadFrustum();
+
+	Con_Printf("%i boxes, %i culled, %i single and %i batched differ from BoxOnPlaneSide\n", CULLBENCH_BOXES, numculled, singlediffs, batchdiffs);
+	Con_Printf("BoxOnPlaneSide %.2f ns, single %.2f ns, batched %.2f ns per box\n", times[0], times[1], times[2]);
+	cullbench_sink = sum;
+}
+
+/* Also called on a dedicated server, where R_Init isn't */
+void R_InitVis(void)
+{
+	Cmd_AddCommand("r_visbench", R_VisBench_f);
+	Cmd_AddCommand("r_cullbench", R_CullBench_f);
+	Cvar_RegisterVariable(&r_visthreads);
+	Cvar_RegisterVariable(&r_viscache);
+}
+
 void R_Init(void)
 {
 	Cmd_AddCommand("timerefresh", R_TimeRefresh_f);
+	Cmd_AddCommand("lightmapstats", R_LightmapStats_f);
 
 	Cvar_RegisterVariable(&r_norefresh);
 	Cvar_RegisterVariable(&r_lightmap);
@@ -542,6 +1348,8 @@ void R_Init(void)
 	Cvar_RegisterVariable(&r_waterwarp);
 	Cvar_RegisterVariable(&r_particles);
 	Cvar_RegisterVariable(&r_particles_alpha);
+	Cvar_RegisterVariable(&r_batchworld);
+	Cvar_RegisterVariable(&r_queuestats);
 
 	Cvar_RegisterVariable(&r_interpolate_animation);
 	Cvar_RegisterVariable(&r_interpolate_transform);
@@ -111,5 +111,6 @@ extern struct texture_s *r_notexture_mip2;
 void R_RenderView(void); // must set r_refdef first
 void R_NewMap(void);
 void R_Init(void);
+void R_InitVis(void);
 
 #endif /* __RENDER_H */
@@ -195,6 +195,9 @@ extern cvar_t sv_ipmasking;
 extern cvar_t sv_maxvelocity;
 extern cvar_t sv_gravity;
 extern cvar_t sv_nostep;
+extern cvar_t sv_physthreads;
+extern cvar_t sv_thinkqueue;
+extern cvar_t sv_sleepstats;
 extern cvar_t sv_friction;
 extern cvar_t sv_edgefriction;
 extern cvar_t sv_stopspeed;
@@ -238,6 +241,7 @@ void SV_MoveToGoal(void);
 
 /* sv_phys.c */
 void SV_Physics(void);
+void SV_ClearThinks(void);
 
 /* sv_user.c */
 void SV_SetIdealPitch(void);
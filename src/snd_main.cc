@@ -20,6 +20,8 @@
 
 #include "quakedef.h"
 
+#include <atomic>
+
 #define	sound_nominal_clip_dist	1000.0
 
 channel_t snd_channels[MAX_CHANNELS];
@@ -33,6 +35,12 @@ static vec3_t listener_forward;
 static vec3_t listener_right;
 static vec3_t listener_up;
 
+// listener state the channel volumes were last computed for
+static vec3_t spatial_origin;
+static vec3_t spatial_right;
+static int spatial_viewentity = -1;
+static bool snd_respatialize;
+
 int paintedtime;
 
 int s_rawend;
@@ -55,9 +63,69 @@ static cvar_t ambient_fade = { "ambient_fade", "100", CVAR_NONE };
 static cvar_t snd_noextraupdate = { "snd_noextraupdate", "0", CVAR_NONE };
 static cvar_t snd_show = { "snd_show", "0", CVAR_NONE };
 static cvar_t _snd_mixahead = { "_snd_mixahead", "0.1", CVAR_NONE };
+static cvar_t snd_mixthread = { "snd_mixthread", "0", CVAR_ARCHIVE };
+
+/*
+ * Mixer thread state
+ *
+ * With snd_mixthread set, painting is done on a dedicated thread woken by the
+ * audio device callback. That thread owns mix_channels and paintedtime; the
+ * main thread keeps snd_channels for picking and spatialization and forwards
+ * every change through a single-producer/single-consumer command ring.
+ */
+typedef enum
+{
+	SND_CMD_START,	// (re)start a channel from a full copy of its state
+	SND_CMD_VOLUME,	// new spatialized volumes
+	SND_CMD_STOP,
+	SND_CMD_TOTAL,	// total_channels changed
+} snd_cmdtype_t;
+
+typedef struct
+{
+	snd_cmdtype_t type;
+	int index;
+	int timebase; // main thread's idea of paintedtime when posted
+	double time; // for latency stats
+	channel_t chan;
+} snd_cmd_t;
+
+#define	SND_CMD_QUEUE_SIZE 2048 // must be a power of two
+
+static snd_cmd_t snd_cmdqueue[SND_CMD_QUEUE_SIZE];
+static std::atomic<unsigned int> snd_cmdhead; // written by the main thread
+static std::atomic<unsigned int> snd_cmdtail; // written by the mixer
+
+static bool snd_threaded = false;
+static channel_t snd_sent[MAX_CHANNELS]; // last state posted for each channel
+static bool snd_restart[MAX_CHANNELS]; // channel needs a SND_CMD_START
+static int snd_sent_total;
+
+static channel_t mix_channels[MAX_CHANNELS];
+static int mix_total_channels;
+
+static std::atomic<int> snd_mixtime; // paintedtime as published by the mixer
+static std::atomic<bool> snd_mixwrapped;
+
+// stats
+static std::atomic<int> snd_underruns;
+static std::atomic<int> snd_aheadms; // mixed ahead of the DMA position
+static std::atomic<int> snd_cmdcount;
+static std::atomic<int> snd_cmdlatency_total; // in ms
+static std::atomic<int> snd_cmdlatency_max;
+static int snd_cmddrops;
 
 static void SND_Callback_sfxvolume(cvar_t *var)
 {
+	// the mixer thread paints from the table with the buffer locked
+	if (snd_threaded)
+	{
+		SNDDMA_LockBuffer();
+		SND_InitScaletable();
+		SNDDMA_Submit();
+		return;
+	}
+
 	SND_InitScaletable();
 }
 
@@ -72,6 +140,130 @@ static void SND_Callback_snd_filterquality(cvar_t *var)
 
 //=============================================================================
 
+/* paintedtime as seen from the main thread */
+static int S_PaintedTime(void)
+{
+	if (snd_threaded)
+		return snd_mixtime.load(std::memory_order_acquire);
+
+	return paintedtime;
+}
+
+static bool S_PostCommand(snd_cmdtype_t type, int index, const channel_t *chan)
+{
+	unsigned int head = snd_cmdhead.load(std::memory_order_relaxed);
+	unsigned int tail = snd_cmdtail.load(std::memory_order_acquire);
+	if (head - tail >= SND_CMD_QUEUE_SIZE)
+	{
+		snd_cmddrops++;
+		return false;
+	}
+
+	snd_cmd_t *cmd = &snd_cmdqueue[head & (SND_CMD_QUEUE_SIZE - 1)];
+	cmd->type = type;
+	cmd->index = index;
+	cmd->timebase = S_PaintedTime();
+	cmd->time = Sys_DoubleTime();
+	if (chan)
+		cmd->chan = *chan;
+
+	snd_cmdhead.store(head + 1, std::memory_order_release);
+
+	return true;
+}
+
+/* forwards any change to a channel since it was last posted to the mixer */
+static void S_SyncChannel(int ch_idx)
+{
+	if (!snd_threaded)
+		return;
+
+	channel_t *ch = &snd_channels[ch_idx];
+	channel_t *sent = &snd_sent[ch_idx];
+
+	if (snd_restart[ch_idx] || ch->sfx != sent->sfx)
+	{
+		if (ch->sfx)
+		{
+			if (!S_PostCommand(SND_CMD_START, ch_idx, ch))
+				return;
+		}
+		else
+		{
+			if (!S_PostCommand(SND_CMD_STOP, ch_idx, NULL))
+				return;
+		}
+		*sent = *ch;
+		snd_restart[ch_idx] = false;
+	}
+	else if (ch->sfx && (ch->leftvol != sent->leftvol || ch->rightvol != sent->rightvol))
+	{
+		if (!S_PostCommand(SND_CMD_VOLUME, ch_idx, ch))
+			return;
+		sent->leftvol = ch->leftvol;
+		sent->rightvol = ch->rightvol;
+	}
+}
+
+static void S_SyncMixer(void)
+{
+	if (!snd_threaded)
+		return;
+
+	if (total_channels != snd_sent_total)
+	{
+		if (S_PostCommand(SND_CMD_TOTAL, total_channels, NULL))
+			snd_sent_total = total_channels;
+	}
+
+	for (int i = 0; i < MAX_CHANNELS; i++)
+	{
+		if (snd_channels[i].sfx || snd_sent[i].sfx)
+			S_SyncChannel(i);
+	}
+}
+
+/* drains the command queue, mixer thread side */
+static void S_RunCommands(void)
+{
+	unsigned int tail = snd_cmdtail.load(std::memory_order_relaxed);
+	unsigned int head = snd_cmdhead.load(std::memory_order_acquire);
+	double now = Sys_DoubleTime();
+
+	for (; tail != head; tail++)
+	{
+		snd_cmd_t *cmd = &snd_cmdqueue[tail & (SND_CMD_QUEUE_SIZE - 1)];
+		channel_t *ch = &mix_channels[cmd->index];
+
+		switch (cmd->type)
+		{
+		case SND_CMD_START:
+			*ch = cmd->chan;
+			ch->end += paintedtime - cmd->timebase;
+			break;
+		case SND_CMD_VOLUME:
+			ch->leftvol = cmd->chan.leftvol;
+			ch->rightvol = cmd->chan.rightvol;
+			break;
+		case SND_CMD_STOP:
+			ch->sfx = NULL;
+			ch->end = 0;
+			break;
+		case SND_CMD_TOTAL:
+			mix_total_channels = cmd->index;
+			break;
+		}
+
+		int latency = (int) ((now - cmd->time) * 1000);
+		snd_cmdcount++;
+		snd_cmdlatency_total += latency;
+		if (latency > snd_cmdlatency_max)
+			snd_cmdlatency_max = latency;
+	}
+
+	snd_cmdtail.store(tail, std::memory_order_release);
+}
+
 /* spatializes a channel */
 static void SND_Spatialize(channel_t *ch)
 {
@@ -113,43 +305,238 @@ static void SND_Spatialize(channel_t *ch)
 		ch->leftvol = 0;
 }
 
-/* picks a channel based on priorities, empty slots, number of channels */
-static channel_t *SND_PickChannel(int entnum, int entchannel)
+/*
+ * Voice manager
+ *
+ * Every dynamic channel is either on the free list or playing, in which case
+ * it sits in a min-heap keyed on its end time and in a hash on entnum so
+ * S_StartSound never has to scan all of them. Heap keys are our own copy of
+ * ch->end; the mixer may push end forward when a sound loops, which
+ * S_ReapVoices picks up once the old key expires.
+ */
+#define	VOICE_HASH_SIZE 64 // must be a power of two
+
+static int voice_free[MAX_DYNAMIC_CHANNELS];
+static int voice_numfree;
+
+static int voice_heap[MAX_DYNAMIC_CHANNELS];
+static int voice_heapsize;
+static int voice_heappos[MAX_DYNAMIC_CHANNELS]; // -1 when not playing
+static int voice_key[MAX_DYNAMIC_CHANNELS];
+
+static int voice_hash[VOICE_HASH_SIZE];
+static int voice_hashnext[MAX_DYNAMIC_CHANNELS];
+
+static int sfx_started[MAX_DYNAMIC_CHANNELS]; // voices started since the last S_Update
+static int num_sfx_started;
+
+static inline channel_t *Voice_Channel(int voice)
+{
+	return &snd_channels[NUM_AMBIENTS + voice];
+}
+
+static inline int Voice_Hash(int entnum)
 {
-	// Check for replacement sound, or find the best one to replace
-	int first_to_die = -1;
-	int life_left = 0x7fffffff;
-	for (int ch_idx = NUM_AMBIENTS; ch_idx < NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS; ch_idx++)
+	return entnum & (VOICE_HASH_SIZE - 1);
+}
+
+static void Voice_Reset(void)
+{
+	voice_numfree = 0;
+	for (int i = MAX_DYNAMIC_CHANNELS - 1; i >= 0; i--)
 	{
-		if (entchannel != 0 && // channel 0 never overrides
-		    snd_channels[ch_idx].entnum == entnum &&
-		    (snd_channels[ch_idx].entchannel == entchannel || entchannel == -1))
-		{
-			// always override sound from same entity
-			first_to_die = ch_idx;
+		voice_free[voice_numfree++] = i;
+		voice_heappos[i] = -1;
+	}
+	voice_heapsize = 0;
+	num_sfx_started = 0;
+
+	for (int i = 0; i < VOICE_HASH_SIZE; i++)
+		voice_hash[i] = -1;
+}
+
+static void Voice_HeapSwap(int a, int b)
+{
+	int tmp = voice_heap[a];
+	voice_heap[a] = voice_heap[b];
+	voice_heap[b] = tmp;
+	voice_heappos[voice_heap[a]] = a;
+	voice_heappos[voice_heap[b]] = b;
+}
+
+static void Voice_SiftUp(int pos)
+{
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+		if (voice_key[voice_heap[parent]] <= voice_key[voice_heap[pos]])
 			break;
+		Voice_HeapSwap(parent, pos);
+		pos = parent;
+	}
+}
+
+static void Voice_SiftDown(int pos)
+{
+	while (true)
+	{
+		int smallest = pos;
+		int left = pos * 2 + 1;
+		int right = left + 1;
+		if (left < voice_heapsize && voice_key[voice_heap[left]] < voice_key[voice_heap[smallest]])
+			smallest = left;
+		if (right < voice_heapsize && voice_key[voice_heap[right]] < voice_key[voice_heap[smallest]])
+			smallest = right;
+		if (smallest == pos)
+			break;
+		Voice_HeapSwap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+static void Voice_HashRemove(int voice)
+{
+	int *link = &voice_hash[Voice_Hash(Voice_Channel(voice)->entnum)];
+	while (*link != -1)
+	{
+		if (*link == voice)
+		{
+			*link = voice_hashnext[voice];
+			return;
 		}
+		link = &voice_hashnext[*link];
+	}
+}
 
-		// don't let monster sounds override player sounds
-		if (snd_channels[ch_idx].entnum == cl.viewentity &&
-		    entnum != cl.viewentity &&
-		    snd_channels[ch_idx].sfx)
-			continue;
+/* takes a voice out of the heap and hash, it must be playing */
+static void Voice_Remove(int voice)
+{
+	int pos = voice_heappos[voice];
+	voice_heapsize--;
+	if (pos != voice_heapsize)
+	{
+		Voice_HeapSwap(pos, voice_heapsize);
+		int moved = voice_heap[pos];
+		Voice_SiftUp(pos);
+		Voice_SiftDown(voice_heappos[moved]);
+	}
+	voice_heappos[voice] = -1;
+
+	Voice_HashRemove(voice);
+}
+
+static void Voice_Release(int voice)
+{
+	if (voice_heappos[voice] != -1)
+		Voice_Remove(voice);
+	voice_free[voice_numfree++] = voice;
+}
+
+/* moves a freshly set up channel into the heap, or back to the free list */
+static void Voice_Insert(int voice)
+{
+	channel_t *ch = Voice_Channel(voice);
+	if (!ch->sfx)
+	{
+		voice_free[voice_numfree++] = voice;
+		return;
+	}
+
+	voice_key[voice] = ch->end;
+	voice_heap[voice_heapsize] = voice;
+	voice_heappos[voice] = voice_heapsize;
+	voice_heapsize++;
+	Voice_SiftUp(voice_heappos[voice]);
+
+	int hash = Voice_Hash(ch->entnum);
+	voice_hashnext[voice] = voice_hash[hash];
+	voice_hash[hash] = voice;
+}
 
-		if (snd_channels[ch_idx].end - paintedtime < life_left)
+/* frees voices that have finished, and catches up on ones that looped */
+static void S_ReapVoices(void)
+{
+	int now = S_PaintedTime();
+
+	while (voice_heapsize && voice_key[voice_heap[0]] <= now)
+	{
+		int voice = voice_heap[0];
+		channel_t *ch = Voice_Channel(voice);
+
+		// the mixer only advances channels it could hear
+		if (ch->sfx && ch->end <= now)
+		{
+			sfxcache_t *sc = S_LoadSound(ch->sfx);
+			if (sc && sc->loopstart >= 0 && sc->length > sc->loopstart)
+			{
+				int looplen = sc->length - sc->loopstart;
+				ch->end += ((now - ch->end) / looplen + 1) * looplen;
+			}
+			else
+			{
+				ch->sfx = NULL;
+				S_SyncChannel(NUM_AMBIENTS + voice);
+			}
+		}
+
+		if (ch->sfx)
 		{
-			life_left = snd_channels[ch_idx].end - paintedtime;
-			first_to_die = ch_idx;
+			voice_key[voice] = ch->end;
+			Voice_SiftDown(0);
+		}
+		else
+		{
+			Voice_Release(voice);
 		}
 	}
+}
 
-	if (first_to_die == -1)
-		return NULL;
+/* picks a voice based on priorities, empty slots, number of channels */
+static int SND_PickVoice(int entnum, int entchannel)
+{
+	// always override sound from same entity, channel 0 never overrides
+	if (entchannel != 0)
+	{
+		for (int voice = voice_hash[Voice_Hash(entnum)]; voice != -1; voice = voice_hashnext[voice])
+		{
+			channel_t *ch = Voice_Channel(voice);
+			if (ch->entnum == entnum && (ch->entchannel == entchannel || entchannel == -1))
+			{
+				Voice_Remove(voice);
+				return voice;
+			}
+		}
+	}
+
+	S_ReapVoices();
 
-	if (snd_channels[first_to_die].sfx)
-		snd_channels[first_to_die].sfx = NULL;
+	if (voice_numfree)
+		return voice_free[--voice_numfree];
 
-	return &snd_channels[first_to_die];
+	// find the one closest to finishing, but don't let monster sounds
+	// override player sounds
+	int skipped[MAX_DYNAMIC_CHANNELS];
+	int numskipped = 0;
+	int voice = -1;
+	while (voice_heapsize)
+	{
+		int top = voice_heap[0];
+		if (entnum != cl.viewentity && Voice_Channel(top)->entnum == cl.viewentity)
+		{
+			skipped[numskipped++] = top;
+			Voice_Remove(top);
+			continue;
+		}
+
+		voice = top;
+		Voice_Remove(top);
+		break;
+	}
+
+	for (int i = 0; i < numskipped; i++)
+		Voice_Insert(skipped[i]);
+
+	return voice;
 }
 
 /* Start a sound effect */
@@ -159,9 +546,10 @@ void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float f
 		return;
 
 	// pick a channel to play on
-	channel_t *target_chan = SND_PickChannel(entnum, entchannel);
-	if (!target_chan)
+	int voice = SND_PickVoice(entnum, entchannel);
+	if (voice == -1)
 		return;
+	channel_t *target_chan = Voice_Channel(voice);
 
 	// spatialize
 	memset(target_chan, 0, sizeof(*target_chan));
@@ -172,27 +560,38 @@ void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float f
 	target_chan->entchannel = entchannel;
 	SND_Spatialize(target_chan);
 
+	int ch_idx = target_chan - snd_channels;
+
 	if (!target_chan->leftvol && !target_chan->rightvol)
+	{
+		Voice_Insert(voice);
+		S_SyncChannel(ch_idx);
 		return; // not audible at all
+	}
 
 	// new channel
 	sfxcache_t *sc = S_LoadSound(sfx);
 	if (!sc)
 	{
-		target_chan->sfx = NULL;
+		Voice_Insert(voice);
+		S_SyncChannel(ch_idx);
 		return; // couldn't load the sound's data
 	}
 
 	target_chan->sfx = sfx;
 	target_chan->pos = 0.0;
-	target_chan->end = paintedtime + sc->length;
+	target_chan->end = S_PaintedTime() + sc->length;
+	snd_restart[ch_idx] = true;
 
 	// if an identical sound has also been started this frame, offset the pos
 	// a bit to keep it from just making the first one louder
-	for (size_t ch_idx = NUM_AMBIENTS; ch_idx < NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS; ch_idx++)
+	for (int i = 0; i < num_sfx_started; i++)
 	{
-		channel_t *check = &snd_channels[ch_idx];
-		if (check == target_chan || check->sfx != sfx || check->pos)
+		if (sfx_started[i] == voice)
+			continue; // restarted on the same voice, not an identical sound
+
+		channel_t *check = Voice_Channel(sfx_started[i]);
+		if (check->sfx != sfx)
 			continue;
 
 		int skip = 0.1 * shm->speed;
@@ -204,17 +603,27 @@ void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float f
 		target_chan->end -= skip;
 		break;
 	}
+	if (num_sfx_started < MAX_DYNAMIC_CHANNELS)
+		sfx_started[num_sfx_started++] = voice;
+
+	Voice_Insert(voice);
+	S_SyncChannel(ch_idx);
 }
 
 void S_StopSound(int entnum, int entchannel)
 {
-	for (size_t i = 0; i < MAX_DYNAMIC_CHANNELS; i++)
+	if (!sound_started)
+		return;
+
+	for (int voice = voice_hash[Voice_Hash(entnum)]; voice != -1; voice = voice_hashnext[voice])
 	{
-		if (snd_channels[i].entnum == entnum &&
-		    snd_channels[i].entchannel == entchannel)
+		channel_t *ch = Voice_Channel(voice);
+		if (ch->entnum == entnum && ch->entchannel == entchannel)
 		{
-			snd_channels[i].end = 0;
-			snd_channels[i].sfx = NULL;
+			ch->end = 0;
+			ch->sfx = NULL;
+			Voice_Release(voice);
+			S_SyncChannel(NUM_AMBIENTS + voice);
 			return;
 		}
 	}
@@ -234,6 +643,8 @@ void S_StopAllSounds(bool clear)
 	}
 
 	memset(snd_channels, 0, MAX_CHANNELS * sizeof(channel_t));
+	Voice_Reset();
+	S_SyncMixer();
 
 	if (clear)
 		S_ClearBuffer();
@@ -289,9 +700,10 @@ void S_StaticSound(sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 	VectorCopy(origin, ss->origin);
 	ss->master_vol = (int) vol;
 	ss->dist_mult = (attenuation / 64) / sound_nominal_clip_dist;
-	ss->end = paintedtime + sc->length;
+	ss->end = S_PaintedTime() + sc->length;
 
 	SND_Spatialize(ss);
+	snd_respatialize = true;
 }
 
 /* FIXME: do we really need the blocking at the driver level? */
@@ -351,7 +763,16 @@ static int GetSoundtime(void)
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			paintedtime = fullsamples;
-			S_StopAllSounds(true);
+			if (snd_threaded)
+			{
+				// let the main thread stop its own copies
+				memset(mix_channels, 0, sizeof(mix_channels));
+				snd_mixwrapped = true;
+			}
+			else
+			{
+				S_StopAllSounds(true);
+			}
 		}
 	}
 	oldsamplepos = samplepos;
@@ -359,11 +780,8 @@ static int GetSoundtime(void)
 	return (buffers * fullsamples) + (samplepos / shm->channels);
 }
 
-static void S_Update_(void)
+static void S_Mix(channel_t *channels, int numchannels)
 {
-	if (!sound_started || snd_blocked)
-		return;
-
 	SNDDMA_LockBuffer();
 	if (!shm->buffer)
 		return;
@@ -375,6 +793,8 @@ static void S_Update_(void)
 	if (paintedtime < soundtime)
 	{
 		// Con_Printf ("S_Update_ : overflow\n");
+		if (paintedtime)
+			snd_underruns++;
 		paintedtime = soundtime;
 	}
 
@@ -383,11 +803,87 @@ static void S_Update_(void)
 	int samps = shm->samples >> (shm->channels - 1);
 	endtime = min(endtime, (unsigned int )(soundtime + samps));
 
-	S_PaintChannels(endtime);
+	S_PaintChannels(channels, numchannels, endtime);
+	snd_aheadms = (paintedtime - soundtime) * 1000 / shm->speed;
 
 	SNDDMA_Submit();
 }
 
+/* called from the audio device's thread once per callback */
+static void S_MixThread(void)
+{
+	S_RunCommands();
+	S_Mix(mix_channels, mix_total_channels);
+	snd_mixtime.store(paintedtime, std::memory_order_release);
+}
+
+static void S_Update_(void)
+{
+	if (!sound_started || snd_blocked || snd_threaded)
+		return;
+
+	S_Mix(snd_channels, total_channels);
+}
+
+static void S_StartMixThread(void)
+{
+	if (snd_threaded)
+		return;
+
+	// nothing is painting, so the mixer can start from our state
+	memcpy(mix_channels, snd_channels, sizeof(mix_channels));
+	memcpy(snd_sent, snd_channels, sizeof(snd_sent));
+	memset(snd_restart, 0, sizeof(snd_restart));
+	mix_total_channels = snd_sent_total = total_channels;
+	snd_cmdhead = snd_cmdtail = 0;
+	snd_mixtime = paintedtime;
+	snd_mixwrapped = false;
+
+	snd_threaded = true;
+	if (!SNDDMA_StartMixThread(S_MixThread))
+	{
+		Con_Printf("Couldn't start sound mixer thread\n");
+		snd_threaded = false;
+	}
+}
+
+static void S_StopMixThread(void)
+{
+	if (!snd_threaded)
+		return;
+
+	SNDDMA_StopMixThread();
+
+	// pick up whatever the mixer had not seen yet, then take back its
+	// positions so playback continues where it left off
+	S_RunCommands();
+	memcpy(snd_channels, mix_channels, sizeof(snd_channels));
+	total_channels = mix_total_channels;
+
+	snd_threaded = false;
+}
+
+/* the mixer wrapped paintedtime, main thread side */
+static void S_CheckMixWrap(void)
+{
+	if (snd_mixwrapped)
+	{
+		snd_mixwrapped = false;
+		S_StopAllSounds(true);
+	}
+}
+
+static void S_Callback_snd_mixthread(cvar_t *var)
+{
+	if (!sound_started)
+		return;
+
+	if (var->value)
+		S_StartMixThread();
+	else
+		S_StopMixThread();
+}
+
 static void S_UpdateAmbientSounds(void)
 {
 	// no ambients when disconnected
@@ -430,20 +926,9 @@ static void S_UpdateAmbientSounds(void)
 	}
 }
 
-/* Called once each time through the main loop */
-void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+/* respatializes static and dynamic sounds */
+static void S_SpatializeChannels(void)
 {
-	if (!sound_started || snd_blocked)
-		return;
-
-	VectorCopy(origin, listener_origin);
-	VectorCopy(forward, listener_forward);
-	VectorCopy(right, listener_right);
-	VectorCopy(up, listener_up);
-
-	// update general area ambient sound sources
-	S_UpdateAmbientSounds();
-
 	channel_t *combine = NULL;
 
 	// update spatialization for static and dynamic sounds
@@ -493,6 +978,40 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 			}
 		}
 	}
+}
+
+/* Called once each time through the main loop */
+void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+	if (!sound_started || snd_blocked)
+		return;
+
+	VectorCopy(origin, listener_origin);
+	VectorCopy(forward, listener_forward);
+	VectorCopy(right, listener_right);
+	VectorCopy(up, listener_up);
+
+	if (snd_threaded)
+		S_CheckMixWrap();
+	S_ReapVoices();
+	num_sfx_started = 0;
+
+	// update general area ambient sound sources
+	S_UpdateAmbientSounds();
+
+	// channel origins are fixed, so volumes only change when the listener
+	// moves or new static sounds need combining
+	if (snd_respatialize ||
+	    cl.viewentity != spatial_viewentity ||
+	    !VectorCompare(listener_origin, spatial_origin) ||
+	    !VectorCompare(listener_right, spatial_right))
+	{
+		S_SpatializeChannels();
+		VectorCopy(listener_origin, spatial_origin);
+		VectorCopy(listener_right, spatial_right);
+		spatial_viewentity = cl.viewentity;
+		snd_respatialize = false;
+	}
 
 	// debugging output
 	if (snd_show.value)
@@ -514,7 +1033,8 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 	// add raw data from streamed samples
 	// BGM_Update(); // moved to the main loop just before S_Update ()
 
-	// mix some sound
+	// hand the new volumes to the mixer thread, or mix some sound
+	S_SyncMixer();
 	S_Update_();
 }
 
@@ -603,6 +1123,15 @@ static void S_SoundInfo_f(void)
 	Con_Printf("%5d submission_chunk\n", shm->submission_chunk);
 	Con_Printf("%5d total_channels\n", total_channels);
 	Con_Printf("%p dma buffer\n", shm->buffer);
+	Con_Printf("%5d underruns\n", snd_underruns.load());
+	Con_Printf("%5d ms mixed ahead\n", snd_aheadms.load());
+	if (snd_threaded)
+	{
+		int count = snd_cmdcount;
+		Con_Printf("mixer thread: %d commands, %d dropped\n", count, snd_cmddrops);
+		Con_Printf("command latency: %d ms avg, %d ms max\n",
+			   count ? snd_cmdlatency_total / count : 0, snd_cmdlatency_max.load());
+	}
 }
 
 void S_Init(void)
@@ -629,6 +1158,8 @@ void S_Init(void)
 	Cvar_RegisterVariable(&snd_noextraupdate);
 	Cvar_RegisterVariable(&snd_show);
 	Cvar_RegisterVariable(&_snd_mixahead);
+	Cvar_RegisterVariable(&snd_mixthread);
+	Cvar_SetCallback(&snd_mixthread, S_Callback_snd_mixthread);
 
 	if (COM_CheckParm("-nosound"))
 		return;
@@ -670,6 +1201,9 @@ void S_Init(void)
 
 	S_StopAllSounds(true);
 
+	if (snd_mixthread.value)
+		S_StartMixThread();
+
 	snd_initialized = true;
 }
 
@@ -678,6 +1212,8 @@ void S_Shutdown(void)
 	if (!sound_started)
 		return;
 
+	S_StopMixThread();
+
 	sound_started = 0;
 	snd_blocked = 0;
 
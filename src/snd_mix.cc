@@ -207,7 +207,7 @@ static void SND_PaintChannelFrom16(channel_t *ch, sfxcache_t *sc, int count, int
 	ch->pos += count;
 }
 
-void S_PaintChannels(int endtime)
+void S_PaintChannels(channel_t *channels, int numchannels, int endtime)
 {
 	int i;
 	int end, ltime, count;
@@ -225,8 +225,8 @@ void S_PaintChannels(int endtime)
 		memset(paintbuffer, 0, (end - paintedtime) * sizeof(portable_samplepair_t));
 
 		// paint in the channels.
-		ch = snd_channels;
-		for (i = 0; i < total_channels; i++, ch++)
+		ch = channels;
+		for (i = 0; i < numchannels; i++, ch++)
 		{
 			if (!ch->sfx)
 				continue;
@@ -28,6 +28,11 @@
 
 static int buffersize;
 
+static SDL_Thread *mix_thread;
+static SDL_sem *mix_sem;
+static SDL_atomic_t mix_quit;
+static void (*mix_func)(void);
+
 int SNDDMA_GetDMAPos(void)
 {
 	return shm->samplepos;
@@ -92,6 +97,71 @@ static void paint_audio(void *unused, Uint8 *stream, int len)
 
 	if (shm->samplepos >= buffersize)
 		shm->samplepos = 0;
+
+	/* wake the mixer to refill what we just consumed */
+	if (mix_sem)
+		SDL_SemPost(mix_sem);
+}
+
+static int mix_thread_main(void *unused)
+{
+	while (!SDL_AtomicGet(&mix_quit))
+	{
+		/* time out so a paused device doesn't keep us from quitting */
+		if (SDL_SemWaitTimeout(mix_sem, 100) == 0)
+			mix_func();
+	}
+
+	return 0;
+}
+
+bool SNDDMA_StartMixThread(void (*mix)(void))
+{
+	if (mix_thread)
+		return true;
+
+	SDL_sem *sem = SDL_CreateSemaphore(0);
+	if (!sem)
+	{
+		Con_Printf("Couldn't create mixer semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	mix_func = mix;
+	SDL_AtomicSet(&mix_quit, 0);
+	SDL_LockAudio();
+	mix_sem = sem;
+	SDL_UnlockAudio();
+
+	mix_thread = SDL_CreateThread(mix_thread_main, "mixer", NULL);
+	if (!mix_thread)
+	{
+		Con_Printf("Couldn't create mixer thread: %s\n", SDL_GetError());
+		SDL_LockAudio();
+		mix_sem = NULL;
+		SDL_UnlockAudio();
+		SDL_DestroySemaphore(sem);
+		return false;
+	}
+
+	return true;
+}
+
+void SNDDMA_StopMixThread(void)
+{
+	if (!mix_thread)
+		return;
+
+	SDL_AtomicSet(&mix_quit, 1);
+	SDL_SemPost(mix_sem);
+	SDL_WaitThread(mix_thread, NULL);
+	mix_thread = NULL;
+
+	SDL_LockAudio();
+	SDL_sem *sem = mix_sem;
+	mix_sem = NULL;
+	SDL_UnlockAudio();
+	SDL_DestroySemaphore(sem);
 }
 
 bool SNDDMA_Init(dma_t *dma)
@@ -199,6 +269,7 @@ void SNDDMA_Shutdown(void)
 	if (shm)
 	{
 		Con_Printf("Shutting down SDL sound\n");
+		SNDDMA_StopMixThread();
 		SDL_CloseAudio();
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 		if (shm->buffer)
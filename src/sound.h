@@ -20,8 +20,8 @@
 #ifndef _SOUND_H
 #define _SOUND_H
 
-#define	MAX_CHANNELS 1024
-#define	MAX_DYNAMIC_CHANNELS 128
+#define	MAX_CHANNELS 1536
+#define	MAX_DYNAMIC_CHANNELS 512
 
 #define DEFAULT_SOUND_PACKET_VOLUME 255
 #define DEFAULT_SOUND_PACKET_ATTENUATION 1.0
@@ -126,7 +126,7 @@ void S_Shutdown(void);
 sfxcache_t *S_LoadSound(sfx_t *s);
 
 // snd_mix.cc
-void S_PaintChannels(int endtime);
+void S_PaintChannels(channel_t *channels, int numchannels, int endtime);
 void SND_InitScaletable(void);
 
 // snd_sdl.cc
@@ -137,5 +137,7 @@ void SNDDMA_BlockSound(void); /* blocks sound output upon window focus loss */
 void SNDDMA_UnblockSound(void); /* unblocks the output upon window focus gain */
 bool SNDDMA_Init(dma_t *dma); /* initializes cycling through a DMA buffer and returns information on it */
 void SNDDMA_Shutdown(void); /* shutdown the DMA xfer */
+bool SNDDMA_StartMixThread(void (*mix)(void)); /* runs mix on its own thread after every device callback */
+void SNDDMA_StopMixThread(void); /* waits for the mixer thread to exit */
 
 #endif	/* _SOUND_H */
@@ -46,6 +46,9 @@ void SV_Init(void)
 	Cvar_RegisterVariable(&sv_idealpitchscale);
 	Cvar_RegisterVariable(&sv_aim);
 	Cvar_RegisterVariable(&sv_nostep);
+	Cvar_RegisterVariable(&sv_physthreads);
+	Cvar_RegisterVariable(&sv_thinkqueue);
+	Cvar_RegisterVariable(&sv_sleepstats);
 	Cvar_RegisterVariable(&sv_altnoclip); //johnfitz
 
 	Cvar_RegisterVariable(&sv_cullentities);	// JPG 2.01
@@ -65,6 +68,8 @@ void SV_Init(void)
 		Cvar_SetQuick(&pq_connectmute, "3"); 	// Baker 3.99g: "Default" it to 10 seconds
 	}
 
+	SV_InitWorld();
+
 	for (int i = 0; i < MAX_MODELS; i++)
 		snprintf(localmodels[i], sizeof(localmodels[i]), "*%i", i);
 }
@@ -415,8 +420,8 @@ static void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg, bool nomap)
 // ignore if not touching a PV leaf
 		if (ent != clent)	// clent is ALWAYS sent
 				{
-// ignore ents without visible models
-			if (!ent->v.modelindex || !PR_GetString(ent->v.model)[0])
+// ignore ents without models, from ed_hot so most never reach the edict
+			if (!ED_Hot(e)->modelindex)
 				continue;
 
 			for (i = 0; i < ent->num_leafs; i++)
@@ -426,6 +431,10 @@ static void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg, bool nomap)
 			if (i == ent->num_leafs)
 				continue;		// not visible
 
+// ignore ents whose model was cleared but not its index, only for visible ones
+			if (!PR_GetString(ent->v.model)[0])
+				continue;
+
 			// JPG 3.30 - don't send updates if the client doesn't have the map
 			if (nomap)
 				continue;
@@ -1042,6 +1051,8 @@ void SV_SpawnServer(char *server)
 	ent->v.modelindex = 1;		// world model
 	ent->v.solid = SOLID_BSP;
 	ent->v.movetype = MOVETYPE_PUSH;
+	ED_DirtyAll();
+	SV_ClearThinks();
 
 	if (coop.value)
 		pr_global_struct->coop = coop.value;
@@ -26,8 +26,7 @@ bool SV_CheckBottom(edict_t *ent)
 {
 	// static int c_yes, c_no;
 
-	vec3_t mins, maxs, start, stop;
-	trace_t trace;
+	vec3_t mins, maxs, start;
 	int x, y;
 	float mid, bottom;
 
@@ -54,6 +53,9 @@ bool SV_CheckBottom(edict_t *ent)
 	// c_no++;
 
 	// check it for real...
+	vec3_t stop;
+	trace_t trace;
+
 	start[2] = mins[2];
 
 	// the midpoint must be within 16 of the bottom
@@ -66,20 +68,29 @@ bool SV_CheckBottom(edict_t *ent)
 		return false;
 	mid = bottom = trace.endpos[2];
 
-	// the corners must be within 16 of the midpoint
+	// the corners are traced together, only once the midpoint has held
+	vec3_t starts[4], stops[4];
+	trace_t traces[4];
+
 	for (x = 0; x <= 1; x++)
 		for (y = 0; y <= 1; y++)
 		{
-			start[0] = stop[0] = x ? maxs[0] : mins[0];
-			start[1] = stop[1] = y ? maxs[1] : mins[1];
+			starts[x * 2 + y][0] = stops[x * 2 + y][0] = x ? maxs[0] : mins[0];
+			starts[x * 2 + y][1] = stops[x * 2 + y][1] = y ? maxs[1] : mins[1];
+			starts[x * 2 + y][2] = start[2];
+			stops[x * 2 + y][2] = stop[2];
+		}
 
-			trace = SV_Move(start, vec3_origin, vec3_origin, stop, true, ent);
+	SV_MoveBatch(starts, stops, 4, vec3_origin, vec3_origin, true, ent, traces);
 
-			if (trace.fraction != 1.0 && trace.endpos[2] > bottom)
-				bottom = trace.endpos[2];
-			if (trace.fraction == 1.0 || mid - trace.endpos[2] > STEPSIZE)
-				return false;
-		}
+	// the corners must be within 16 of the midpoint
+	for (int i = 0; i < 4; i++)
+	{
+		if (traces[i].fraction != 1.0 && traces[i].endpos[2] > bottom)
+			bottom = traces[i].endpos[2];
+		if (traces[i].fraction == 1.0 || mid - traces[i].endpos[2] > STEPSIZE)
+			return false;
+	}
 
 	// c_yes++;
 	return true;
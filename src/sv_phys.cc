@@ -13,6 +13,7 @@
  */
 
 #include "quakedef.h"
+#include "jobs.h"
 
 /*
  * pushmove objects do not obey gravity, and do not interact with each other or
@@ -36,6 +37,9 @@ cvar_t sv_stopspeed = { "sv_stopspeed", "100" };
 cvar_t sv_gravity = { "sv_gravity", "800", false, true };
 cvar_t sv_maxvelocity = { "sv_maxvelocity", "2000" };
 cvar_t sv_nostep = { "sv_nostep", "0" };
+cvar_t sv_physthreads = { "sv_physthreads", "0" };
+cvar_t sv_thinkqueue = { "sv_thinkqueue", "1" };
+cvar_t sv_sleepstats = { "sv_sleepstats", "0" };
 
 #define	MOVE_EPSILON 0.01
 
@@ -75,6 +79,7 @@ static void SV_CheckVelocity(edict_t *ent)
 		{
 			Con_Printf("Got a NaN origin on %s\n", PR_GetString(ent->v.classname));
 			ent->v.origin[i] = 0;
+			ED_Dirty(ent);
 		}
 		if (ent->v.velocity[i] > sv_maxvelocity.value)
 			ent->v.velocity[i] = sv_maxvelocity.value;
@@ -102,6 +107,7 @@ static bool SV_RunThink(edict_t *ent)
 					// it is possible to start that way
 					// by a trigger with a local time.
 	ent->v.nextthink = 0;
+	ED_Dirty(ent);
 	pr_global_struct->time = thinktime;
 	pr_global_struct->self = EDICT_TO_PROG(ent);
 	pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
@@ -117,6 +123,10 @@ static void SV_Impact(edict_t *e1, edict_t *e2)
 	old_self = pr_global_struct->self;
 	old_other = pr_global_struct->other;
 
+	// the move may not have been linked yet
+	ED_Dirty(e1);
+	ED_Dirty(e2);
+
 	pr_global_struct->time = sv.time;
 	if (e1->v.touch && e1->v.solid != SOLID_NOT)
 	{
@@ -311,21 +321,156 @@ static void SV_AddGravity(edict_t *ent)
 	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
 }
 
-/* Does not change the entities velocity at all */
-static trace_t SV_PushEntity(edict_t *ent, vec3_t push)
+/*
+ ===============================================================================
+
+ TOSS MOVES AHEAD OF TIME
+
+ ===============================================================================
+ */
+
+/*
+ * Clipping a toss move against the world is most of its cost, and the world
+ * is the same all frame. So before the edicts run, the moves of the tossed
+ * edicts that won't think this frame are guessed and clipped against the
+ * world on sv_physthreads threads. When an edict then moves, the guess is
+ * only used if its start, end and size are exactly what the move has, so
+ * the outcome is the same as without threads. The clip against other
+ * edicts, the touches and everything else still happen in edict order.
+ */
+
+typedef struct
+{
+	bool ready;
+	vec3_t start, end, mins, maxs;
+	trace_t trace;
+} tossmove_t;
+
+static tossmove_t sv_tossmoves[MAX_EDICTS];
+static int sv_tosslist[MAX_EDICTS];
+static int sv_numtoss;
+
+static void SV_TossJob(void *data, int job)
+{
+	int numjobs = *(int *) data;
+
+	for (int i = job; i < sv_numtoss; i += numjobs)
+	{
+		tossmove_t *move = &sv_tossmoves[sv_tosslist[i]];
+		move->trace = SV_ClipMoveToEntity(sv.edicts, move->start, move->mins, move->maxs, move->end);
+	}
+}
+
+/* Guesses the moves SV_Physics_Toss will make and clips them against the world */
+static void SV_PrepareTossMoves(int numthreads)
+{
+	edict_t *ent;
+	int i;
+
+	sv_numtoss = 0;
+
+	ent = EDICT_NUM(svs.maxclients + 1);
+	for (i = svs.maxclients + 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	{
+		edhot_t *hot = ED_Hot(i);
+
+		if (hot->free)
+			continue;
+		if (hot->movetype != MOVETYPE_TOSS && hot->movetype != MOVETYPE_BOUNCE
+				&& hot->movetype != MOVETYPE_FLY && hot->movetype != MOVETYPE_FLYMISSILE)
+			continue;
+		if (hot->nextthink > 0 && hot->nextthink <= sv.time + host_frametime)
+			continue; // the think can change anything
+		if ((int) ent->v.flags & FL_ONGROUND)
+			continue;
+
+		// SV_CheckVelocity and SV_AddGravity without touching ent
+		vec3_t velocity, move;
+		bool nan = false;
+
+		for (int j = 0; j < 3; j++)
+		{
+			nan |= std::isnan(ent->v.velocity[j]) || std::isnan(ent->v.origin[j]);
+			velocity[j] = CLAMP(-sv_maxvelocity.value, ent->v.velocity[j], sv_maxvelocity.value);
+		}
+		if (nan)
+			continue;
+
+		if (ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE)
+		{
+			eval_t *val = GETEDICTFIELDVALUE(ent, eval_gravity);
+			float ent_gravity = (val && val->_float) ? val->_float : 1.0;
+
+			velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
+		}
+
+		tossmove_t *tm = &sv_tossmoves[i];
+
+		VectorScale(velocity, host_frametime, move);
+		VectorCopy(ent->v.origin, tm->start);
+		VectorAdd(ent->v.origin, move, tm->end);
+		VectorCopy(ent->v.mins, tm->mins);
+		VectorCopy(ent->v.maxs, tm->maxs);
+		tm->ready = true;
+		sv_tosslist[sv_numtoss++] = i;
+	}
+
+	if (!sv_numtoss)
+		return;
+
+	int numjobs = min(sv_numtoss, numthreads * 4);
+	Jobs_Run(SV_TossJob, &numjobs, numjobs, numthreads);
+}
+
+/* The world clip worked out for this move, if the guess was right */
+static trace_t *SV_TossWorldTrace(edict_t *ent, vec3_t end)
+{
+	tossmove_t *tm = &sv_tossmoves[NUM_FOR_EDICT(ent)];
+
+	if (!tm->ready)
+		return NULL;
+
+	tm->ready = false;
+	if (!VectorCompare(tm->start, ent->v.origin) || !VectorCompare(tm->end, end)
+			|| !VectorCompare(tm->mins, ent->v.mins) || !VectorCompare(tm->maxs, ent->v.maxs))
+		return NULL;
+
+	return &tm->trace;
+}
+
+static void SV_FinishTossMoves(void)
+{
+	for (int i = 0; i < sv_numtoss; i++)
+		sv_tossmoves[sv_tosslist[i]].ready = false;
+	sv_numtoss = 0;
+}
+
+//============================================================================
+
+/*
+ * Does not change the entities velocity at all
+ * tossed moves may use the world clip from SV_PrepareTossMoves
+ */
+static trace_t SV_PushEntity(edict_t *ent, vec3_t push, bool tossed)
 {
 	trace_t trace;
 	vec3_t end;
+	int type;
 
 	VectorAdd(ent->v.origin, push, end);
 
 	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
+		type = MOVE_MISSILE;
 	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
-		// only clip against bmodels
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
+		type = MOVE_NOMONSTERS; // only clip against bmodels
+	else
+		type = MOVE_NORMAL;
+
+	trace_t *world = tossed ? SV_TossWorldTrace(ent, end) : NULL;
+	if (world)
+		trace = SV_MoveEntities(world, ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 	else
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 
 	VectorCopy(trace.endpos, ent->v.origin);
 	SV_LinkEdict(ent, true);
@@ -371,16 +516,20 @@ static void SV_PushMove(edict_t *pusher, float movetime)
 	check = NEXT_EDICT(sv.edicts);
 	for (e = 1; e < sv.num_edicts; e++, check = NEXT_EDICT(check))
 	{
-		if (check->free)
+		edhot_t *hot = ED_Hot(e);
+
+		if (hot->free)
 			continue;
-		if (check->v.movetype == MOVETYPE_PUSH || check->v.movetype == MOVETYPE_NONE || check->v.movetype == MOVETYPE_NOCLIP)
+		if (hot->movetype == MOVETYPE_PUSH || hot->movetype == MOVETYPE_NONE || hot->movetype == MOVETYPE_NOCLIP)
 			continue;
 
+		bool outside = hot->absmin[0] >= maxs[0] || hot->absmin[1] >= maxs[1] || hot->absmin[2] >= maxs[2] || hot->absmax[0] <= mins[0]
+				|| hot->absmax[1] <= mins[1] || hot->absmax[2] <= mins[2];
+
 		// if the entity is standing on the pusher, it will definately be moved
 		if (!(((int) check->v.flags & FL_ONGROUND) && PROG_TO_EDICT(check->v.groundentity) == pusher))
 		{
-			if (check->v.absmin[0] >= maxs[0] || check->v.absmin[1] >= maxs[1] || check->v.absmin[2] >= maxs[2] || check->v.absmax[0] <= mins[0]
-					|| check->v.absmax[1] <= mins[1] || check->v.absmax[2] <= mins[2])
+			if (outside)
 				continue;
 
 			// see if the ent's bbox is inside the pusher's final position
@@ -399,8 +548,10 @@ static void SV_PushMove(edict_t *pusher, float movetime)
 
 		// try moving the contacted entity 
 		pusher->v.solid = SOLID_NOT;
-		SV_PushEntity(check, move);
+		ED_Dirty(pusher);
+		SV_PushEntity(check, move, false);
 		pusher->v.solid = SOLID_BSP;
+		ED_Dirty(pusher);
 
 		// if it is still inside the pusher, block
 		block = SV_TestEntityPosition(check);
@@ -412,6 +563,7 @@ static void SV_PushMove(edict_t *pusher, float movetime)
 			{	// corpse
 				check->v.mins[0] = check->v.mins[1] = 0;
 				VectorCopy(check->v.mins, check->v.maxs);
+				ED_Dirty(check);
 				continue;
 			}
 
@@ -478,20 +630,24 @@ static void SV_PushRotate(edict_t *pusher, float movetime)
 	check = NEXT_EDICT(sv.edicts);
 	for (e = 1; e < sv.num_edicts; e++, check = NEXT_EDICT(check))
 	{
-		if (check->free)
+		edhot_t *hot = ED_Hot(e);
+
+		if (hot->free)
 			continue;
-		if (check->v.movetype == MOVETYPE_PUSH ||
-		    check->v.movetype == MOVETYPE_NONE ||
-//		    check->v.movetype == MOVETYPE_FOLLOW ||
-		    check->v.movetype == MOVETYPE_NOCLIP)
+		if (hot->movetype == MOVETYPE_PUSH ||
+		    hot->movetype == MOVETYPE_NONE ||
+//		    hot->movetype == MOVETYPE_FOLLOW ||
+		    hot->movetype == MOVETYPE_NOCLIP)
 			continue;
 
+		bool outside = hot->absmin[0] >= pusher->v.absmax[0] || hot->absmin[1] >= pusher->v.absmax[1] || hot->absmin[2] >= pusher->v.absmax[2]
+				|| hot->absmax[0] <= pusher->v.absmin[0] || hot->absmax[1] <= pusher->v.absmin[1]
+				|| hot->absmax[2] <= pusher->v.absmin[2];
+
 		// if the entity is standing on the pusher, it will definately be moved
 		if (!(((int) check->v.flags & FL_ONGROUND) && PROG_TO_EDICT(check->v.groundentity) == pusher))
 		{
-			if (check->v.absmin[0] >= pusher->v.absmax[0] || check->v.absmin[1] >= pusher->v.absmax[1] || check->v.absmin[2] >= pusher->v.absmax[2]
-					|| check->v.absmax[0] <= pusher->v.absmin[0] || check->v.absmax[1] <= pusher->v.absmin[1]
-					|| check->v.absmax[2] <= pusher->v.absmin[2])
+			if (outside)
 				continue;
 
 			// see if the ent's bbox is inside the pusher's final position
@@ -517,8 +673,10 @@ static void SV_PushRotate(edict_t *pusher, float movetime)
 
 		// try moving the contacted entity
 		pusher->v.solid = SOLID_NOT;
-		SV_PushEntity(check, move);
+		ED_Dirty(pusher);
+		SV_PushEntity(check, move, false);
 		pusher->v.solid = SOLID_BSP;
+		ED_Dirty(pusher);
 
 		// if it is still inside the pusher, block
 		block = SV_TestEntityPosition(check);
@@ -530,6 +688,7 @@ static void SV_PushRotate(edict_t *pusher, float movetime)
 			{   // corpse
 				check->v.mins[0] = check->v.mins[1] = 0;
 				VectorCopy(check->v.mins, check->v.maxs);
+				ED_Dirty(check);
 				continue;
 			}
 
@@ -595,6 +754,7 @@ static void SV_Physics_Pusher(edict_t *ent)
 	if (thinktime > oldltime && thinktime <= ent->v.ltime)
 	{
 		ent->v.nextthink = 0;
+		ED_Dirty(ent);
 		pr_global_struct->time = sv.time;
 		pr_global_struct->self = EDICT_TO_PROG(ent);
 		pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
@@ -683,7 +843,7 @@ static void SV_Physics_Toss(edict_t *ent)
 
 	// move origin
 	VectorScale(ent->v.velocity, host_frametime, move);
-	trace = SV_PushEntity(ent, move);
+	trace = SV_PushEntity(ent, move, true);
 	if (trace.fraction == 1)
 		return;
 	if (ent->free)
@@ -898,7 +1058,7 @@ static int SV_TryUnstick(edict_t *ent, vec3_t oldvel)
 			break;
 		}
 
-		SV_PushEntity(ent, dir);
+		SV_PushEntity(ent, dir, false);
 
 		// retry the original move
 		ent->v.velocity[0] = oldvel[0];
@@ -965,7 +1125,7 @@ static void SV_WalkMove(edict_t *ent)
 	downmove[2] = -STEPSIZE + oldvel[2] * host_frametime;
 
 	// move up
-	SV_PushEntity(ent, upmove); // FIXME: don't link?
+	SV_PushEntity(ent, upmove, false); // FIXME: don't link?
 
 	// move forward
 	ent->v.velocity[0] = oldvel[0];
@@ -988,7 +1148,7 @@ static void SV_WalkMove(edict_t *ent)
 		SV_WallFriction(ent, &steptrace);
 
 	// move down
-	downtrace = SV_PushEntity(ent, downmove); // FIXME: don't link?
+	downtrace = SV_PushEntity(ent, downmove, false); // FIXME: don't link?
 
 	if (downtrace.plane.normal[2] > 0.7)
 	{
@@ -1069,6 +1229,309 @@ static void SV_Physics_Client(edict_t *ent, int num)
 	PR_ExecuteProgram(pr_global_struct->PlayerPostThink);
 }
 
+/*
+ ===============================================================================
+
+ THINK SCHEDULING
+
+ ===============================================================================
+ */
+
+/*
+ * Most edicts are MOVETYPE_NONE and only need a visit when their think is
+ * due. Their think times are kept in a heap, and SV_Physics visits only the
+ * clients, the edicts that move and the ones due to think, still in edict
+ * order. Stores to nextthink, movetype or free go through ED_Dirty, which
+ * leaves the edict in ed_changed for SV_ScheduleChanged.
+ *
+ * Tossed and stepping edicts resting on the ground do nothing but think
+ * either, so after a visit that leaves them resting they are put to sleep
+ * and scheduled like MOVETYPE_NONE. Any watched store wakes them: origin,
+ * velocity, flags, the water fields, a link after a pusher moved them, or
+ * a change to the edict they rest on.
+ */
+
+typedef struct
+{
+	float time;
+	int num;
+} thinkentry_t;
+
+#define	MAX_THINK_ENTRIES (MAX_EDICTS * 2)
+
+static thinkentry_t sv_thinkheap[MAX_THINK_ENTRIES];
+static int sv_numthinks;
+static float sv_thinkat[MAX_EDICTS]; // time last put in the heap
+static unsigned int sv_moving[MAX_EDICTS / 32]; // visited every frame
+static unsigned int sv_due[MAX_EDICTS / 32]; // visited once
+static unsigned int sv_asleep[MAX_EDICTS / 32];
+static int sv_numasleep;
+static short sv_sleepground[MAX_EDICTS]; // what a sleeping edict rests on
+static short sv_groundrefs[MAX_EDICTS]; // sleeping edicts resting on this one
+
+void SV_ClearThinks(void)
+{
+	sv_numthinks = 0;
+	memset(sv_thinkat, 0, sizeof(sv_thinkat));
+	memset(sv_moving, 0, sizeof(sv_moving));
+	memset(sv_due, 0, sizeof(sv_due));
+	memset(sv_asleep, 0, sizeof(sv_asleep));
+	memset(sv_groundrefs, 0, sizeof(sv_groundrefs));
+	sv_numasleep = 0;
+}
+
+/* The test SV_RunThink makes */
+static bool SV_ThinkDue(float thinktime)
+{
+	return !(thinktime <= 0 || thinktime > sv.time + host_frametime);
+}
+
+static void SV_PushThink(float time, int num);
+
+/* Stale times fill the heap up, so start it again from the edicts */
+static void SV_RebuildThinks(void)
+{
+	sv_numthinks = 0;
+	for (int i = 0; i < sv.num_edicts; i++)
+	{
+		edhot_t *hot = ED_Hot(i);
+
+		sv_thinkat[i] = 0;
+		if (!hot->free && hot->nextthink > 0 && !(sv_moving[i >> 5] & (1u << (i & 31))))
+			SV_PushThink(hot->nextthink, i);
+	}
+}
+
+static void SV_PushThink(float time, int num)
+{
+	if (sv_numthinks == MAX_THINK_ENTRIES)
+	{
+		SV_RebuildThinks();
+		return;
+	}
+
+	int i = sv_numthinks++;
+	while (i > 0)
+	{
+		int parent = (i - 1) >> 1;
+
+		if (sv_thinkheap[parent].time <= time)
+			break;
+		sv_thinkheap[i] = sv_thinkheap[parent];
+		i = parent;
+	}
+	sv_thinkheap[i].time = time;
+	sv_thinkheap[i].num = num;
+	sv_thinkat[num] = time;
+}
+
+static thinkentry_t SV_PopThink(void)
+{
+	thinkentry_t top = sv_thinkheap[0];
+	thinkentry_t last = sv_thinkheap[--sv_numthinks];
+	int i = 0;
+
+	for (;;)
+	{
+		int child = i * 2 + 1;
+
+		if (child >= sv_numthinks)
+			break;
+		if (child + 1 < sv_numthinks && sv_thinkheap[child + 1].time < sv_thinkheap[child].time)
+			child++;
+		if (last.time <= sv_thinkheap[child].time)
+			break;
+		sv_thinkheap[i] = sv_thinkheap[child];
+		i = child;
+	}
+	if (sv_numthinks)
+		sv_thinkheap[i] = last;
+
+	return top;
+}
+
+static void SV_Wake(int num)
+{
+	sv_asleep[num >> 5] &= ~(1u << (num & 31));
+	sv_moving[num >> 5] |= 1u << (num & 31);
+	sv_numasleep--;
+	if (sv_sleepground[num])
+		sv_groundrefs[sv_sleepground[num]]--;
+}
+
+/* The ground under some sleeping edicts changed */
+static void SV_WakeResting(int ground)
+{
+	for (int w = 0; w << 5 < sv.num_edicts && sv_groundrefs[ground]; w++)
+	{
+		for (unsigned int bits = sv_asleep[w]; bits; bits &= bits - 1)
+		{
+			int num = (w << 5) + __builtin_ctz(bits);
+
+			if (sv_sleepground[num] == ground)
+				SV_Wake(num);
+		}
+	}
+}
+
+/* Puts the edict to sleep if its last visit left it resting */
+static void SV_CheckSleep(edict_t *ent, int num)
+{
+	edhot_t *hot = ED_Hot(num);
+	bool resting = false;
+
+	if (num > svs.maxclients && !hot->free)
+	{
+		if (hot->movetype == MOVETYPE_STEP)
+			resting = (int) ent->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM);
+		else if (hot->movetype == MOVETYPE_TOSS || hot->movetype == MOVETYPE_BOUNCE
+				|| hot->movetype == MOVETYPE_FLY || hot->movetype == MOVETYPE_FLYMISSILE)
+			resting = (int) ent->v.flags & FL_ONGROUND;
+	}
+
+	if (sv_asleep[num >> 5] & (1u << (num & 31)))
+	{
+		if (!resting)
+			SV_Wake(num);
+		return;
+	}
+	if (!resting)
+		return;
+
+	sv_asleep[num >> 5] |= 1u << (num & 31);
+	sv_moving[num >> 5] &= ~(1u << (num & 31));
+	sv_numasleep++;
+
+	int ground = NUM_FOR_EDICT(PROG_TO_EDICT(ent->v.groundentity));
+	sv_sleepground[num] = ground;
+	if (ground)
+		sv_groundrefs[ground]++;
+
+	if (hot->nextthink > 0 && hot->nextthink != sv_thinkat[num])
+		SV_PushThink(hot->nextthink, num);
+}
+
+static void SV_ScheduleEdict(int num)
+{
+	edhot_t *hot = ED_Hot(num);
+	unsigned int bit = 1u << (num & 31);
+	int w = num >> 5;
+
+	if (sv_groundrefs[num])
+		SV_WakeResting(num);
+	if (sv_asleep[w] & bit)
+		SV_Wake(num);
+
+	if (hot->free)
+	{
+		sv_moving[w] &= ~bit;
+		return;
+	}
+
+	if (num <= svs.maxclients || hot->movetype != MOVETYPE_NONE)
+	{
+		sv_moving[w] |= bit;
+		return;
+	}
+	sv_moving[w] &= ~bit;
+
+	if (SV_ThinkDue(hot->nextthink))
+		sv_due[w] |= bit;
+	else if (hot->nextthink > 0 && hot->nextthink != sv_thinkat[num])
+		SV_PushThink(hot->nextthink, num);
+}
+
+/* Looks again at the edicts written since the last call */
+static void SV_ScheduleChanged(void)
+{
+	ed_anychanged = false;
+
+	for (int w = 0; w << 5 < sv.num_edicts; w++)
+	{
+		while (ed_changed[w])
+		{
+			int num = (w << 5) + __builtin_ctz(ed_changed[w]);
+
+			ed_changed[w] &= ed_changed[w] - 1;
+			if (num < sv.num_edicts)
+				SV_ScheduleEdict(num); // ED_Alloc marks the rest again
+		}
+	}
+}
+
+/* Marks the edicts whose think comes due this frame */
+static void SV_ScheduleThinks(void)
+{
+	SV_ScheduleChanged();
+
+	while (sv_numthinks && SV_ThinkDue(sv_thinkheap[0].time))
+	{
+		thinkentry_t think = SV_PopThink();
+		edhot_t *hot = ED_Hot(think.num);
+
+		if (think.time != sv_thinkat[think.num] || hot->free || hot->nextthink != think.time)
+			continue; // since changed
+		sv_thinkat[think.num] = 0;
+		sv_due[think.num >> 5] |= 1u << (think.num & 31);
+	}
+}
+
+/* The next edict after i that SV_Physics has to visit, or -1 */
+static int SV_NextScheduled(int i)
+{
+	if (ed_anychanged)
+		SV_ScheduleChanged(); // thinks set during this frame
+
+	for (int num = i + 1; num < sv.num_edicts;)
+	{
+		int w = num >> 5;
+		unsigned int bits = (sv_moving[w] | sv_due[w]) & (~0u << (num & 31));
+
+		if (bits)
+		{
+			num = (w << 5) + __builtin_ctz(bits);
+			if (num >= sv.num_edicts)
+				break;
+			sv_due[w] &= ~(1u << (num & 31));
+			return num;
+		}
+		num = (w + 1) << 5;
+	}
+
+	return -1;
+}
+
+//============================================================================
+
+static void SV_RunEdict(edict_t *ent, int i)
+{
+	if (ED_Hot(i)->free)
+		return;
+
+	if (pr_global_struct->force_retouch)
+		SV_LinkEdict(ent, true); // force retouch even for stationary
+
+	float movetype = ED_Hot(i)->movetype; // touches may have changed it
+
+	if (i > 0 && i <= svs.maxclients)
+		SV_Physics_Client(ent, i);
+	else if (movetype == MOVETYPE_PUSH)
+		SV_Physics_Pusher(ent);
+	else if (movetype == MOVETYPE_NONE)
+		SV_Physics_None(ent);
+	else if (movetype == MOVETYPE_NOCLIP)
+		SV_Physics_Noclip(ent);
+	else if (movetype == MOVETYPE_STEP)
+		SV_Physics_Step(ent);
+	else if (movetype == MOVETYPE_TOSS ||
+	         movetype == MOVETYPE_BOUNCE ||
+	         movetype == MOVETYPE_FLY ||
+	         movetype == MOVETYPE_FLYMISSILE)
+		SV_Physics_Toss(ent);
+	else
+		Sys_Error("bad movetype %i", (int) movetype);
+}
+
 void SV_Physics(void)
 {
 	int i;
@@ -1082,35 +1545,53 @@ void SV_Physics(void)
 
 //	SV_CheckAllEnts ();
 
-	// treat each object in turn
-	ent = sv.edicts;
-	for (i = 0; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	int numthreads = min((int) sv_physthreads.value, MAX_JOB_THREADS);
+	if (numthreads > 0)
+		SV_PrepareTossMoves(numthreads);
+
+	if (pr_global_struct->force_retouch || !sv_thinkqueue.value)
 	{
-		if (ent->free)
-			continue;
+		// treat each object in turn
+		ent = sv.edicts;
+		for (i = 0; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+			SV_RunEdict(ent, i);
+	}
+	else
+	{
+		// only the ones that move or think
+		int visited = 0;
 
-		if (pr_global_struct->force_retouch)
-			SV_LinkEdict(ent, true); // force retouch even for stationary
-
-		if (i > 0 && i <= svs.maxclients)
-			SV_Physics_Client(ent, i);
-		else if (ent->v.movetype == MOVETYPE_PUSH)
-			SV_Physics_Pusher(ent);
-		else if (ent->v.movetype == MOVETYPE_NONE)
-			SV_Physics_None(ent);
-		else if (ent->v.movetype == MOVETYPE_NOCLIP)
-			SV_Physics_Noclip(ent);
-		else if (ent->v.movetype == MOVETYPE_STEP)
-			SV_Physics_Step(ent);
-		else if (ent->v.movetype == MOVETYPE_TOSS ||
-		         ent->v.movetype == MOVETYPE_BOUNCE ||
-		         ent->v.movetype == MOVETYPE_FLY ||
-		         ent->v.movetype == MOVETYPE_FLYMISSILE)
-			SV_Physics_Toss(ent);
-		else
-			Sys_Error("bad movetype %i", (int) ent->v.movetype);
+		SV_ScheduleThinks();
+		for (i = SV_NextScheduled(-1); i >= 0; i = SV_NextScheduled(i))
+		{
+			unsigned int bit = 1u << (i & 31);
+			unsigned int changed = ed_changed[i >> 5] & bit;
+
+			ent = EDICT_NUM(i);
+			SV_RunEdict(ent, i);
+
+			// SV_RunThink clears nextthink on every think, so a sleeping
+			// edict that only changed during its own visit is not woken,
+			// just put to sleep again below if it still rests
+			if (!changed && (ed_changed[i >> 5] & bit) && (sv_asleep[i >> 5] & bit))
+			{
+				ed_changed[i >> 5] &= ~bit;
+				if (sv_groundrefs[i])
+					SV_WakeResting(i);
+				SV_Wake(i);
+			}
+
+			SV_CheckSleep(ent, i);
+			visited++;
+		}
+
+		if (sv_sleepstats.value)
+			Con_Printf("%4i edicts %4i skipped %4i asleep\n", sv.num_edicts, sv.num_edicts - visited, sv_numasleep);
 	}
 
+	SV_FinishTossMoves();
+	SV_LeafStats();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
@@ -43,6 +43,7 @@ typedef struct
 static hull_t box_hull;
 static dclipnode_t box_clipnodes[6];
 static mplane_t box_planes[6];
+static mclipnode_t box_nodes[6];
 
 /*
  * Set up the planes and clipnodes so that the six floats of a bounding box
@@ -54,6 +55,9 @@ static void SV_InitBoxHull(void)
 	box_hull.planes = box_planes;
 	box_hull.firstclipnode = 0;
 	box_hull.lastclipnode = 5;
+	box_hull.nodes = box_nodes;
+	box_hull.numnodes = 6;
+	box_hull.firstnode = 0;
 
 	for (int i = 0; i < 6; i++)
 	{
@@ -69,6 +73,11 @@ static void SV_InitBoxHull(void)
 
 		box_planes[i].type = i >> 1;
 		box_planes[i].normal[i >> 1] = 1;
+
+		box_nodes[i].children[0] = box_clipnodes[i].children[0];
+		box_nodes[i].children[1] = box_clipnodes[i].children[1];
+		box_nodes[i].type = i >> 1;
+		box_nodes[i].normal[i >> 1] = 1;
 	}
 }
 
@@ -85,6 +94,9 @@ static hull_t *SV_HullForBox(vec3_t mins, vec3_t maxs)
 	box_planes[4].dist = maxs[2];
 	box_planes[5].dist = mins[2];
 
+	for (int i = 0; i < 6; i++)
+		box_nodes[i].dist = box_planes[i].dist;
+
 	return &box_hull;
 }
 
@@ -134,6 +146,344 @@ static hull_t *SV_HullForEntity(edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t o
 	return hull;
 }
 
+/*
+ ===============================================================================
+
+ AREA TREE
+
+ ===============================================================================
+ */
+
+/*
+ * A dynamic bounding volume tree over the linked edicts, used instead of the
+ * area nodes when sv_areatree is set at map start. Triggers and everything
+ * else get their own tree, like the two lists of an area node. Leaves carry
+ * the edict's box grown by AREA_MARGIN, so a small move relinks without
+ * touching the tree, and rotations keep it balanced as edicts come and go.
+ */
+
+#define	AREA_MARGIN	16
+#define	AREA_SOLID	0
+#define	AREA_TRIGGER	1
+#define	MAX_AREA_STACK	256
+
+typedef struct
+{
+	vec3_t mins, maxs;
+	int parent; // next free node when unused
+	int children[2]; // -1 on leaves
+	int height; // 0 on leaves
+	edict_t *ent; // leaves only
+	int list; // AREA_SOLID or AREA_TRIGGER
+	bool linked; // cleared by SV_UnlinkEdict, the leaf stays for the relink
+} areaproxy_t;
+
+typedef struct
+{
+	areaproxy_t *nodes;
+	int numnodes;
+	int freenode;
+	int roots[2];
+} areatree_t;
+
+static cvar_t sv_areatree = { "sv_areatree", "0" };
+
+static areatree_t sv_tree;
+static bool sv_usetree;
+
+static void SV_TreeClear(areatree_t *tree)
+{
+	free(tree->nodes);
+	tree->nodes = NULL;
+	tree->numnodes = 0;
+	tree->freenode = -1;
+	tree->roots[AREA_SOLID] = tree->roots[AREA_TRIGGER] = -1;
+}
+
+static int SV_TreeAllocNode(areatree_t *tree)
+{
+	if (tree->freenode == -1)
+	{
+		int count = tree->numnodes ? tree->numnodes * 2 : 256;
+
+		tree->nodes = (areaproxy_t *)Q_realloc(tree->nodes, count * sizeof(areaproxy_t));
+		for (int i = tree->numnodes; i < count; i++)
+			tree->nodes[i].parent = (i + 1 < count) ? i + 1 : -1;
+		tree->freenode = tree->numnodes;
+		tree->numnodes = count;
+	}
+
+	int num = tree->freenode;
+	areaproxy_t *node = &tree->nodes[num];
+
+	tree->freenode = node->parent;
+	memset(node, 0, sizeof(*node));
+	node->parent = -1;
+	node->children[0] = node->children[1] = -1;
+
+	return num;
+}
+
+static void SV_TreeFreeNode(areatree_t *tree, int num)
+{
+	tree->nodes[num].parent = tree->freenode;
+	tree->freenode = num;
+}
+
+/* Half the surface area of the union of two boxes */
+static float SV_TreeCost(vec3_t mins1, vec3_t maxs1, vec3_t mins2, vec3_t maxs2)
+{
+	vec3_t size;
+
+	for (int i = 0; i < 3; i++)
+		size[i] = max(maxs1[i], maxs2[i]) - min(mins1[i], mins2[i]);
+
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+/* Recomputes a node's box and height from its children */
+static void SV_TreeRefit(areatree_t *tree, int num)
+{
+	areaproxy_t *node = &tree->nodes[num];
+	areaproxy_t *c0 = &tree->nodes[node->children[0]];
+	areaproxy_t *c1 = &tree->nodes[node->children[1]];
+
+	for (int i = 0; i < 3; i++)
+	{
+		node->mins[i] = min(c0->mins[i], c1->mins[i]);
+		node->maxs[i] = max(c0->maxs[i], c1->maxs[i]);
+	}
+	node->height = 1 + max(c0->height, c1->height);
+}
+
+/*
+ * If one child of a node is more than one level taller than the other,
+ * lifts the taller child into the node's place, giving it the node and the
+ * shorter of its own children. Returns the node now at this place.
+ */
+static int SV_TreeBalance(areatree_t *tree, int *root, int a)
+{
+	areaproxy_t *nodes = tree->nodes;
+	areaproxy_t *node = &nodes[a];
+
+	if (node->children[0] == -1 || node->height < 2)
+		return a;
+
+	int diff = nodes[node->children[1]].height - nodes[node->children[0]].height;
+	if (diff >= -1 && diff <= 1)
+		return a;
+
+	int side = diff > 1; // the taller child
+	int b = node->children[side];
+	areaproxy_t *up = &nodes[b];
+	int big = up->children[0], small = up->children[1];
+
+	if (nodes[small].height > nodes[big].height)
+	{
+		big = up->children[1];
+		small = up->children[0];
+	}
+
+	// b takes a's place
+	up->parent = node->parent;
+	if (up->parent == -1)
+		*root = b;
+	else if (nodes[up->parent].children[0] == a)
+		nodes[up->parent].children[0] = b;
+	else
+		nodes[up->parent].children[1] = b;
+
+	// a keeps its other child and takes b's shorter one
+	node->children[side] = small;
+	nodes[small].parent = a;
+	node->parent = b;
+	SV_TreeRefit(tree, a);
+
+	up->children[0] = a;
+	up->children[1] = big;
+	SV_TreeRefit(tree, b);
+
+	return b;
+}
+
+/* Refits and balances from num up to the root */
+static void SV_TreeFixUp(areatree_t *tree, int *root, int num)
+{
+	while (num != -1)
+	{
+		num = SV_TreeBalance(tree, root, num);
+		SV_TreeRefit(tree, num);
+		num = tree->nodes[num].parent;
+	}
+}
+
+/*
+ * Adds a leaf for ent, descending towards the sibling that grows the tree's
+ * surface area the least, and returns it.
+ */
+static int SV_TreeInsert(areatree_t *tree, int list, edict_t *ent)
+{
+	int *root = &tree->roots[list];
+	int leaf = SV_TreeAllocNode(tree);
+	areaproxy_t *node = &tree->nodes[leaf];
+
+	node->ent = ent;
+	node->list = list;
+	for (int i = 0; i < 3; i++)
+	{
+		node->mins[i] = ent->v.absmin[i] - AREA_MARGIN;
+		node->maxs[i] = ent->v.absmax[i] + AREA_MARGIN;
+	}
+
+	if (*root == -1)
+	{
+		*root = leaf;
+		return leaf;
+	}
+
+	// find the best sibling
+	int num = *root;
+	while (tree->nodes[num].children[0] != -1)
+	{
+		areaproxy_t *n = &tree->nodes[num];
+		float area = SV_TreeCost(n->mins, n->maxs, n->mins, n->maxs);
+		float combined = SV_TreeCost(n->mins, n->maxs, node->mins, node->maxs);
+		float cost = 2 * combined; // a new parent for this node and the leaf
+		float inherited = 2 * (combined - area); // the growth pushed onto the children
+		float childcost[2];
+
+		for (int i = 0; i < 2; i++)
+		{
+			areaproxy_t *c = &tree->nodes[n->children[i]];
+			childcost[i] = SV_TreeCost(c->mins, c->maxs, node->mins, node->maxs) + inherited;
+			if (c->children[0] != -1)
+				childcost[i] -= SV_TreeCost(c->mins, c->maxs, c->mins, c->maxs);
+		}
+
+		if (cost < childcost[0] && cost < childcost[1])
+			break;
+
+		num = n->children[childcost[1] < childcost[0]];
+	}
+
+	// give the sibling and the leaf a new parent
+	int parent = SV_TreeAllocNode(tree);
+	int oldparent = tree->nodes[num].parent;
+	areaproxy_t *p = &tree->nodes[parent];
+
+	node = &tree->nodes[leaf];
+	p->parent = oldparent;
+	p->list = list;
+	p->children[0] = num;
+	p->children[1] = leaf;
+	tree->nodes[num].parent = parent;
+	node->parent = parent;
+
+	if (oldparent == -1)
+		*root = parent;
+	else if (tree->nodes[oldparent].children[0] == num)
+		tree->nodes[oldparent].children[0] = parent;
+	else
+		tree->nodes[oldparent].children[1] = parent;
+
+	SV_TreeFixUp(tree, root, parent);
+
+	return leaf;
+}
+
+static void SV_TreeRemove(areatree_t *tree, int leaf)
+{
+	int *root = &tree->roots[tree->nodes[leaf].list];
+	int parent = tree->nodes[leaf].parent;
+
+	SV_TreeFreeNode(tree, leaf);
+	if (parent == -1)
+	{
+		*root = -1;
+		return;
+	}
+
+	// the sibling takes the parent's place
+	areaproxy_t *p = &tree->nodes[parent];
+	int sibling = p->children[p->children[0] == leaf];
+	int grandparent = p->parent;
+
+	tree->nodes[sibling].parent = grandparent;
+	SV_TreeFreeNode(tree, parent);
+
+	if (grandparent == -1)
+	{
+		*root = sibling;
+		return;
+	}
+
+	areaproxy_t *g = &tree->nodes[grandparent];
+	g->children[g->children[1] == parent] = sibling;
+	SV_TreeFixUp(tree, root, grandparent);
+}
+
+/*
+ * Collects the linked edicts of one list whose leaf boxes meet the box, left
+ * child first, so the same tree always gives the same order.
+ */
+static int SV_TreeQuery(areatree_t *tree, int list, vec3_t mins, vec3_t maxs, edict_t **out)
+{
+	int stack[MAX_AREA_STACK];
+	int depth = 0, count = 0;
+
+	if (tree->roots[list] != -1)
+		stack[depth++] = tree->roots[list];
+
+	while (depth)
+	{
+		areaproxy_t *node = &tree->nodes[stack[--depth]];
+
+		if (mins[0] > node->maxs[0] || mins[1] > node->maxs[1] || mins[2] > node->maxs[2]
+				|| maxs[0] < node->mins[0] || maxs[1] < node->mins[1] || maxs[2] < node->mins[2])
+			continue;
+
+		if (node->children[0] == -1)
+		{
+			if (node->linked)
+				out[count++] = node->ent;
+			continue;
+		}
+
+		if (depth + 2 > MAX_AREA_STACK)
+			Sys_Error("SV_TreeQuery: stack overflow");
+		stack[depth++] = node->children[1];
+		stack[depth++] = node->children[0];
+	}
+
+	return count;
+}
+
+/* Links ent into the live tree, keeping its leaf if the box still fits */
+static void SV_TreeLinkEdict(edict_t *ent)
+{
+	int list = (ent->v.solid == SOLID_TRIGGER) ? AREA_TRIGGER : AREA_SOLID;
+	int leaf = ent->arealeaf - 1;
+
+	if (leaf >= 0)
+	{
+		areaproxy_t *node = &sv_tree.nodes[leaf];
+
+		if (node->list == list
+				&& ent->v.absmin[0] >= node->mins[0] && ent->v.absmin[1] >= node->mins[1] && ent->v.absmin[2] >= node->mins[2]
+				&& ent->v.absmax[0] <= node->maxs[0] && ent->v.absmax[1] <= node->maxs[1] && ent->v.absmax[2] <= node->maxs[2])
+		{
+			node->linked = true;
+			return;
+		}
+
+		SV_TreeRemove(&sv_tree, leaf);
+	}
+
+	leaf = SV_TreeInsert(&sv_tree, list, ent);
+	sv_tree.nodes[leaf].linked = true;
+	ent->arealeaf = leaf + 1;
+}
+
 /*
  ===============================================================================
  ENTITY AREA CHECKING
@@ -179,6 +529,85 @@ static areanode_t *SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+ * Touch pairs: the triggers an edict's box met when it last touched, in
+ * the order the area nodes gave them. They hold while the box is the same
+ * and none of the area nodes the walk reached has had its trigger list
+ * changed since, which a stamp per area node tells.
+ */
+
+#define	MAX_TOUCH_PAIRS	8
+
+typedef struct
+{
+	int stamp; // sv_touchstamp when filled, 0 when empty
+	unsigned int nodes; // a bit per area node reached, AREA_NODES fits
+	vec3_t absmin, absmax;
+	int numtouch;
+	edict_t *touch[MAX_TOUCH_PAIRS];
+	int trigger_node; // area node a linked trigger is in, -1 when not
+} touchcache_t;
+
+static cvar_t sv_touchpairs = { "sv_touchpairs", "1" };
+
+static touchcache_t sv_touchcache[MAX_EDICTS];
+static int sv_areastamps[AREA_NODES]; // sv_touchstamp when each trigger list last changed
+static int sv_touchstamp;
+static int sv_touchhits, sv_touchmisses;
+
+static void SV_ClearTouchPairs(void)
+{
+	memset(sv_touchcache, 0, sizeof(sv_touchcache));
+	for (int i = 0; i < MAX_EDICTS; i++)
+		sv_touchcache[i].trigger_node = -1;
+	memset(sv_areastamps, 0, sizeof(sv_areastamps));
+	sv_touchstamp = 1;
+	sv_touchhits = sv_touchmisses = 0;
+}
+
+static void SV_TriggersChanged(int node)
+{
+	sv_areastamps[node] = ++sv_touchstamp;
+}
+
+/* True if ent's touch pairs still give what a walk would */
+static bool SV_TouchPairsHold(touchcache_t *cache, edict_t *ent)
+{
+	if (!cache->stamp || !VectorCompare(cache->absmin, ent->v.absmin) || !VectorCompare(cache->absmax, ent->v.absmax))
+		return false;
+
+	for (int i = 0; i < sv_numareanodes; i++)
+	{
+		if ((cache->nodes & (1u << i)) && sv_areastamps[i] > cache->stamp)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Every edict keeps the deepest BSP node its abs box was wholly inside when
+ * last found from the world root, and how far the box could move and stay
+ * on the same side of every plane above that node. The leaf walk then
+ * starts at that node for as long as the box stays within that distance,
+ * which gives the same leafs in the same order. When the node is a leaf,
+ * nothing is walked at all.
+ */
+
+#define	LEAF_EPSILON 0.125 // covers rounding in the plane tests
+
+typedef struct
+{
+	mnode_t *node;
+	vec3_t absmin, absmax; // box the node was found for
+	float slack; // how far any side of the box can move
+} leafcache_t;
+
+static cvar_t sv_leafcache = { "sv_leafcache", "1" };
+static cvar_t sv_leafstats = { "sv_leafstats", "0" };
+static leafcache_t sv_leafnodes[MAX_EDICTS];
+static int sv_leafvisits, sv_leaflinks, sv_leafhits;
+
 /* called after the world model has been loaded, before linking any entities */
 void SV_ClearWorld(void)
 {
@@ -187,6 +616,13 @@ void SV_ClearWorld(void)
 	memset(sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode(0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	SV_TreeClear(&sv_tree);
+	sv_usetree = sv_areatree.value != 0;
+
+	SV_ClearTouchPairs();
+
+	memset(sv_leafnodes, 0, sizeof(sv_leafnodes));
 }
 
 /*
@@ -196,21 +632,61 @@ void SV_ClearWorld(void)
  */
 void SV_UnlinkEdict(edict_t *ent)
 {
+	if (ent->arealeaf)
+		sv_tree.nodes[ent->arealeaf - 1].linked = false;
+
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
 
 	RemoveLink(&ent->area);
 	ent->area.prev = ent->area.next = NULL;
+
+	touchcache_t *cache = &sv_touchcache[NUM_FOR_EDICT(ent)];
+	if (cache->trigger_node != -1)
+	{
+		SV_TriggersChanged(cache->trigger_node);
+		cache->trigger_node = -1;
+	}
 }
 
-static void SV_TouchLinks(edict_t *ent, areanode_t *node)
+/* Unlinks an edict for good, dropping its area tree leaf */
+void SV_RemoveEdict(edict_t *ent)
 {
-	link_t *l, *next;
+	SV_UnlinkEdict(ent);
+
+	if (ent->arealeaf)
+	{
+		SV_TreeRemove(&sv_tree, ent->arealeaf - 1);
+		ent->arealeaf = 0;
+	}
+
+	sv_touchcache[NUM_FOR_EDICT(ent)].stamp = 0;
+}
+
+static void SV_CallTouch(edict_t *touch, edict_t *ent)
+{
+	int old_self = pr_global_struct->self;
+	int old_other = pr_global_struct->other;
+
+	pr_global_struct->self = EDICT_TO_PROG(touch);
+	pr_global_struct->other = EDICT_TO_PROG(ent);
+	pr_global_struct->time = sv.time;
+	PR_ExecuteProgram(touch->v.touch);
+
+	pr_global_struct->self = old_self;
+	pr_global_struct->other = old_other;
+}
+
+/*
+ * Touches the triggers of one area node from l on. With a record, the ones
+ * the box meets go into it whether they have a touch function or not.
+ */
+static void SV_TouchNodeLinks(edict_t *ent, areanode_t *node, link_t *l, touchcache_t *record)
+{
+	link_t *next;
 	edict_t *touch;
-	int old_self, old_other;
 
-// touch linked edicts
-	for (l = node->trigger_edicts.next; l != &node->trigger_edicts; l = next)
+	for (; l != &node->trigger_edicts; l = next)
 	{
 		//johnfitz -- fixes a crash when a touch function deletes an entity which comes later in the list
 		if (!l)
@@ -224,104 +700,350 @@ static void SV_TouchLinks(edict_t *ent, areanode_t *node)
 		touch = EDICT_FROM_AREA(l);
 		if (touch == ent)
 			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
-			continue;
 		if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2]
 				|| ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
 			continue;
 
-		old_self = pr_global_struct->self;
-		old_other = pr_global_struct->other;
+		if (record)
+		{
+			if (record->numtouch < MAX_TOUCH_PAIRS)
+				record->touch[record->numtouch] = touch;
+			record->numtouch++;
+		}
 
-		pr_global_struct->self = EDICT_TO_PROG(touch);
-		pr_global_struct->other = EDICT_TO_PROG(ent);
-		pr_global_struct->time = sv.time;
-		PR_ExecuteProgram(touch->v.touch);
+		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+			continue;
 
-		pr_global_struct->self = old_self;
-		pr_global_struct->other = old_other;
+		SV_CallTouch(touch, ent);
 	}
+}
+
+static void SV_TouchLinks(edict_t *ent, areanode_t *node, touchcache_t *record)
+{
+// touch linked edicts
+	SV_TouchNodeLinks(ent, node, node->trigger_edicts.next, record);
+	if (record)
+		record->nodes |= 1u << (node - sv_areanodes);
 
 	// recurse down both sides
 	if (node->axis == -1)
 		return;
 
 	if (ent->v.absmax[node->axis] > node->dist)
-		SV_TouchLinks(ent, node->children[0]);
+		SV_TouchLinks(ent, node->children[0], record);
 	if (ent->v.absmin[node->axis] < node->dist)
-		SV_TouchLinks(ent, node->children[1]);
+		SV_TouchLinks(ent, node->children[1], record);
 }
 
-static void SV_FindTouchedLeafs(edict_t *ent, mnode_t *node)
+/*
+ * Finishes an area node walk that was at link l of target when a touch
+ * function changed things, just as the walk itself would have gone on.
+ * The nodes are numbered depth first, so target is under the second child
+ * if its number is at least that child's.
+ */
+static void SV_TouchResume(edict_t *ent, areanode_t *node, areanode_t *target, link_t *l)
 {
-	mplane_t *splitplane;
-	mleaf_t *leaf;
-	int sides, leafnum;
-
-	if (node->contents == CONTENTS_SOLID)
-		return;
-
-	// add an efrag if the node is a leaf
-	if (node->contents < 0)
+	if (node == target)
 	{
-		if (ent->num_leafs == MAX_ENT_LEAFS)
-			return;
+		SV_TouchNodeLinks(ent, node, l, NULL);
 
-		leaf = (mleaf_t *) node;
-		leafnum = leaf - sv.worldmodel->brushmodel->leafs - 1;
+		if (node->axis == -1)
+			return;
 
-		ent->leafnums[ent->num_leafs] = leafnum;
-		ent->num_leafs++;
+		if (ent->v.absmax[node->axis] > node->dist)
+			SV_TouchLinks(ent, node->children[0], NULL);
+		if (ent->v.absmin[node->axis] < node->dist)
+			SV_TouchLinks(ent, node->children[1], NULL);
 		return;
 	}
 
-	// NODE_MIXED
-	splitplane = node->plane;
-	sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, splitplane);
-
-	// recurse down the contacted sides
-	if (sides & 1)
-		SV_FindTouchedLeafs(ent, node->children[0]);
+	if (target >= node->children[1])
+	{
+		SV_TouchResume(ent, node->children[1], target, l);
+		return;
+	}
 
-	if (sides & 2)
-		SV_FindTouchedLeafs(ent, node->children[1]);
+	SV_TouchResume(ent, node->children[0], target, l);
+	if (ent->v.absmin[node->axis] < node->dist)
+		SV_TouchLinks(ent, node->children[1], NULL);
 }
 
 /*
- * Needs to be called any time an entity changes origin, mins, maxs, or solid
- * flags ent->v.modified
- * sets ent->v.absmin and ent->v.absmax
- * if touchtriggers, calls prog functions for the intersected triggers
+ * Touches the triggers ent's box meets in area node order. When the touch
+ * pairs hold they stand in for the walk, up to the first touch function
+ * that moves ent or changes a trigger list; the walk goes on from there.
+ * Otherwise the walk runs and, if nothing changed under it, refills them.
  */
-void SV_LinkEdict(edict_t *ent, bool touch_triggers)
+static void SV_TouchTriggers(edict_t *ent, bool usepairs)
 {
-	areanode_t *node;
-
-	if (ent->area.prev)
-		SV_UnlinkEdict(ent);	// unlink from old position
+	touchcache_t *cache = &sv_touchcache[NUM_FOR_EDICT(ent)];
+	int stamp = sv_touchstamp;
+	vec3_t absmin, absmax;
 
-	if (ent == sv.edicts)
-		return;		// don't add the world
+	VectorCopy(ent->v.absmin, absmin);
+	VectorCopy(ent->v.absmax, absmax);
 
-	if (ent->free)
-		return;
+	if (usepairs && SV_TouchPairsHold(cache, ent))
+	{
+		sv_touchhits++;
 
-	// set the abs box
-	// ROTATE START
-	if (ent->v.solid == SOLID_BSP && (ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) && ent != sv.edicts)
-	{   	// expand for rotation
-		float max, v;
-		int i;
+		for (int i = 0; i < cache->numtouch; i++)
+		{
+			edict_t *touch = cache->touch[i];
 
-		max = DotProduct(ent->v.mins, ent->v.mins);
-		v = DotProduct(ent->v.maxs, ent->v.maxs);
+			if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+				continue;
 
-		if (max < v)
-			max = v;
+			link_t *next = touch->area.next;
+			areanode_t *node = &sv_areanodes[sv_touchcache[NUM_FOR_EDICT(touch)].trigger_node];
 
-		max = sqrt(max);
+			SV_CallTouch(touch, ent);
 
-		for (i = 0; i < 3; i++)
+			if (sv_touchstamp != stamp || !VectorCompare(absmin, ent->v.absmin) || !VectorCompare(absmax, ent->v.absmax))
+			{
+				SV_TouchResume(ent, sv_areanodes, node, next);
+				return;
+			}
+		}
+		return;
+	}
+
+	touchcache_t record;
+
+	sv_touchmisses++;
+	record.numtouch = 0;
+	record.nodes = 0;
+	SV_TouchLinks(ent, sv_areanodes, &record);
+
+	if (sv_touchstamp != stamp || record.numtouch > MAX_TOUCH_PAIRS || !VectorCompare(absmin, ent->v.absmin) || !VectorCompare(absmax, ent->v.absmax))
+	{
+		cache->stamp = 0;
+		return;
+	}
+
+	cache->stamp = sv_touchstamp;
+	cache->nodes = record.nodes;
+	VectorCopy(absmin, cache->absmin);
+	VectorCopy(absmax, cache->absmax);
+	cache->numtouch = record.numtouch;
+	memcpy(cache->touch, record.touch, record.numtouch * sizeof(edict_t *));
+}
+
+/*
+ * On the area tree the triggers are collected before any is touched, since a
+ * touch function can change the tree. Each is checked again before its touch.
+ */
+static void SV_TouchTree(edict_t *ent)
+{
+	edict_t *list[MAX_EDICTS];
+	int count = SV_TreeQuery(&sv_tree, AREA_TRIGGER, ent->v.absmin, ent->v.absmax, list);
+
+	for (int i = 0; i < count; i++)
+	{
+		edict_t *touch = list[i];
+
+		if (touch == ent || touch->free || !touch->arealeaf || !sv_tree.nodes[touch->arealeaf - 1].linked)
+			continue;
+		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+			continue;
+		if (ent->v.absmin[0] > touch->v.absmax[0] || ent->v.absmin[1] > touch->v.absmax[1] || ent->v.absmin[2] > touch->v.absmax[2]
+				|| ent->v.absmax[0] < touch->v.absmin[0] || ent->v.absmax[1] < touch->v.absmin[1] || ent->v.absmax[2] < touch->v.absmin[2])
+			continue;
+
+		SV_CallTouch(touch, ent);
+	}
+}
+
+/* Goes down from the root while the box is on one side of the planes */
+static mnode_t *SV_EnclosingNode(vec3_t absmin, vec3_t absmax, float *slack)
+{
+	mnode_t *node = sv.worldmodel->brushmodel->nodes;
+	float least = 1e30f;
+
+	while (node->contents >= 0)
+	{
+		mplane_t *plane = node->plane;
+		int sides = BOX_ON_PLANE_SIDE(absmin, absmax, plane);
+		float lo, hi, norm;
+
+		sv_leafvisits++;
+		if (sides == 3)
+			break;
+
+		// nearest and furthest box corners along the normal
+		if (plane->type < 3)
+		{
+			lo = absmin[plane->type];
+			hi = absmax[plane->type];
+			norm = 1;
+		}
+		else
+		{
+			lo = hi = norm = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				float n = plane->normal[i];
+
+				lo += n * ((n < 0) ? absmax[i] : absmin[i]);
+				hi += n * ((n < 0) ? absmin[i] : absmax[i]);
+				norm += fabsf(n);
+			}
+		}
+
+		float margin = (sides == 1) ? lo - plane->dist : plane->dist - hi;
+		least = min(least, (margin - LEAF_EPSILON) / norm);
+
+		node = node->children[sides - 1];
+	}
+
+	*slack = least;
+	return node;
+}
+
+/* Where SV_FindTouchedLeafs can start for the edict's abs box */
+static mnode_t *SV_LeafNode(edict_t *ent)
+{
+	leafcache_t *cache = &sv_leafnodes[NUM_FOR_EDICT(ent)];
+
+	sv_leaflinks++;
+
+	if (sv_leafcache.value && cache->node)
+	{
+		float move = 0;
+
+		for (int i = 0; i < 3; i++)
+		{
+			move = max(move, fabsf(ent->v.absmin[i] - cache->absmin[i]));
+			move = max(move, fabsf(ent->v.absmax[i] - cache->absmax[i]));
+		}
+
+		if (move <= cache->slack)
+		{
+			sv_leafhits++;
+			return cache->node;
+		}
+	}
+
+	cache->node = SV_EnclosingNode(ent->v.absmin, ent->v.absmax, &cache->slack);
+	VectorCopy(ent->v.absmin, cache->absmin);
+	VectorCopy(ent->v.absmax, cache->absmax);
+
+	return cache->node;
+}
+
+/* Prints and clears the leaf walk counters, once per frame */
+void SV_LeafStats(void)
+{
+	if (sv_leafstats.value)
+		Con_Printf("%4i links %4i cached %5i nodes\n", sv_leaflinks, sv_leafhits, sv_leafvisits);
+
+	sv_leafvisits = sv_leaflinks = sv_leafhits = 0;
+}
+
+static void SV_FindTouchedLeafs(edict_t *ent, mnode_t *node)
+{
+	mplane_t *splitplane;
+	mleaf_t *leaf;
+	int sides, leafnum;
+
+	sv_leafvisits++;
+
+	if (node->contents == CONTENTS_SOLID)
+		return;
+
+	// add an efrag if the node is a leaf
+	if (node->contents < 0)
+	{
+		if (ent->num_leafs == MAX_ENT_LEAFS)
+			return;
+
+		leaf = (mleaf_t *) node;
+		leafnum = leaf - sv.worldmodel->brushmodel->leafs - 1;
+
+		ent->leafnums[ent->num_leafs] = leafnum;
+		ent->num_leafs++;
+		return;
+	}
+
+	// NODE_MIXED
+	splitplane = node->plane;
+	sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, splitplane);
+
+	// recurse down the contacted sides
+	if (sides & 1)
+		SV_FindTouchedLeafs(ent, node->children[0]);
+
+	if (sides & 2)
+		SV_FindTouchedLeafs(ent, node->children[1]);
+}
+
+/* Links ent's abs box into the area nodes */
+static void SV_AreaLinkEdict(edict_t *ent)
+{
+	areanode_t *node;
+
+	// find the first node that the ent's box crosses
+	node = sv_areanodes;
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+
+		if (ent->v.absmin[node->axis] > node->dist)
+			node = node->children[0];
+		else if (ent->v.absmax[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			break; // crosses the node
+	}
+
+	// link it in
+	if (ent->v.solid == SOLID_TRIGGER)
+	{
+		InsertLinkBefore(&ent->area, &node->trigger_edicts);
+		sv_touchcache[NUM_FOR_EDICT(ent)].trigger_node = node - sv_areanodes;
+		SV_TriggersChanged(node - sv_areanodes);
+	}
+	else
+	{
+		InsertLinkBefore(&ent->area, &node->solid_edicts);
+	}
+}
+
+/*
+ * Needs to be called any time an entity changes origin, mins, maxs, or solid
+ * flags ent->v.modified
+ * sets ent->v.absmin and ent->v.absmax
+ * if touchtriggers, calls prog functions for the intersected triggers
+ */
+void SV_LinkEdict(edict_t *ent, bool touch_triggers)
+{
+	ED_Dirty(ent); // origin or size may have been changed before linking
+
+	SV_UnlinkEdict(ent);	// unlink from old position
+
+	if (ent == sv.edicts)
+		return;		// don't add the world
+
+	if (ent->free)
+		return;
+
+	// set the abs box
+	// ROTATE START
+	if (ent->v.solid == SOLID_BSP && (ent->v.angles[0] || ent->v.angles[1] || ent->v.angles[2]) && ent != sv.edicts)
+	{   	// expand for rotation
+		float max, v;
+		int i;
+
+		max = DotProduct(ent->v.mins, ent->v.mins);
+		v = DotProduct(ent->v.maxs, ent->v.maxs);
+
+		if (max < v)
+			max = v;
+
+		max = sqrt(max);
+
+		for (i = 0; i < 3; i++)
 		{
 			ent->v.absmin[i] = ent->v.origin[i] - max;
 			ent->v.absmax[i] = ent->v.origin[i] + max;
@@ -358,35 +1080,27 @@ void SV_LinkEdict(edict_t *ent, bool touch_triggers)
 	// link to PVS leafs
 	ent->num_leafs = 0;
 	if (ent->v.modelindex)
-		SV_FindTouchedLeafs(ent, sv.worldmodel->brushmodel->nodes);
+		SV_FindTouchedLeafs(ent, SV_LeafNode(ent));
 
 	if (ent->v.solid == SOLID_NOT)
+	{
+		SV_RemoveEdict(ent);
 		return;
+	}
 
-	// find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
+	if (sv_usetree)
 	{
-		if (node->axis == -1)
-			break;
-
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break; // crosses the node
+		SV_TreeLinkEdict(ent);
+		if (touch_triggers)
+			SV_TouchTree(ent);
+		return;
 	}
 
-	// link it in
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore(&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore(&ent->area, &node->solid_edicts);
+	SV_AreaLinkEdict(ent);
 
 	// if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
-		SV_TouchLinks(ent, sv_areanodes);
+		SV_TouchTriggers(ent, sv_touchpairs.value != 0);
 }
 
 /*
@@ -398,6 +1112,29 @@ void SV_LinkEdict(edict_t *ent, bool touch_triggers)
  */
 
 static int SV_HullPointContents(hull_t *hull, int num, vec3_t p)
+{
+	float d;
+	mclipnode_t *node;
+
+	while (num >= 0)
+	{
+		node = hull->nodes + num;
+
+		if (node->type < 3)
+			d = p[node->type] - node->dist;
+		else
+			d = DotProduct (node->normal, p) - node->dist;
+
+		num = (d < 0) ? node->children[1] : node->children[0];
+	}
+
+	return num;
+}
+
+/*
+ * The same on the clipnodes as loaded, for the reference tracer.
+ */
+static int SV_ClipnodePointContents(hull_t *hull, int num, vec3_t p)
 {
 	float d;
 	dclipnode_t *node;
@@ -431,7 +1168,9 @@ int SV_PointContents(vec3_t p)
 {
 	int cont;
 
-	cont = SV_HullPointContents(&sv.worldmodel->brushmodel->hulls[0], 0, p);
+	hull_t *hull = &sv.worldmodel->brushmodel->hulls[0];
+
+	cont = SV_HullPointContents(hull, hull->firstnode, p);
 	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
 		cont = CONTENTS_WATER;
 	return cont;
@@ -470,119 +1209,824 @@ bool SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p
 	{
 		switch (num)
 		{
-		case CONTENTS_SOLID:
-			trace->startsolid = true;
-			break;
-		case CONTENTS_EMPTY:
-			trace->allsolid = false;
-			trace->inopen = true;
-			break;
-		default:
-			trace->allsolid = false;
-			trace->inwater = true;
-			break;
+		case CONTENTS_SOLID:
+			trace->startsolid = true;
+			break;
+		case CONTENTS_EMPTY:
+			trace->allsolid = false;
+			trace->inopen = true;
+			break;
+		default:
+			trace->allsolid = false;
+			trace->inwater = true;
+			break;
+		}
+
+		return true; // empty
+	}
+
+	if (num < hull->firstclipnode || num > hull->lastclipnode)
+		Sys_Error("bad node number");
+
+	// find the point distances
+	float t1, t2;
+
+	dclipnode_t *node = &hull->clipnodes[num];
+	mplane_t *plane = &hull->planes[node->planenum];
+
+	if (plane->type < 3)
+	{
+		t1 = p1[plane->type] - plane->dist;
+		t2 = p2[plane->type] - plane->dist;
+	}
+	else
+	{
+		t1 = DotProduct(plane->normal, p1) - plane->dist;
+		t2 = DotProduct(plane->normal, p2) - plane->dist;
+	}
+
+	if (t1 >= 0 && t2 >= 0)
+		return SV_RecursiveHullCheck(hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return SV_RecursiveHullCheck(hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+	// put the crosspoint DIST_EPSILON pixels on the near side
+	float frac;
+	if (t1 < 0)
+		frac = (t1 + DIST_EPSILON) / (t1 - t2);
+	else
+		frac = (t1 - DIST_EPSILON) / (t1 - t2);
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+
+	vec3_t mid;
+	for (size_t i = 0; i < 3; i++)
+		mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+
+	float midf = p1f + (p2f - p1f) * frac;
+
+	int side = (t1 < 0);
+
+	// move up to the node
+	if (!SV_RecursiveHullCheck(hull, node->children[side], p1f, midf, p1, mid, trace))
+		return false;
+
+#ifdef PARANOID
+	if (SV_HullPointContents(sv_hullmodel, mid, node->children[side]) == CONTENTS_SOLID)
+	{
+		Con_Printf("mid PointInHullSolid\n");
+		return false;
+	}
+#endif
+
+	if (SV_ClipnodePointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID) // go past the node
+		return SV_RecursiveHullCheck(hull, node->children[side ^ 1], midf, p2f, mid, p2, trace);
+
+	if (trace->allsolid)
+		return false; // never got out of the solid area
+
+	// the other side of the node is solid, this is the impact point
+	if (!side)
+	{
+		VectorCopy(plane->normal, trace->plane.normal);
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		VectorSubtract(vec3_origin, plane->normal, trace->plane.normal);
+		trace->plane.dist = -plane->dist;
+	}
+
+	// shouldn't really happen, but does occasionally
+	while (SV_ClipnodePointContents(hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
+	{
+		frac -= 0.1;
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			VectorCopy(mid, trace->endpos);
+			// Con_DPrintf ("backup past 0\n"); // JPG - removed this (it was spamming big time)
+			return false;
+		}
+		midf = p1f + (p2f - p1f) * frac;
+		for (size_t i = 0; i < 3; i++)
+			mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+	}
+
+	trace->fraction = midf;
+	VectorCopy(mid, trace->endpos);
+
+	return false;
+}
+
+
+/*
+ * The same trace without recursion. A node the line crosses leaves a frame
+ * on an explicit stack holding what's needed once the near side is done:
+ * go on past the node, or stop at it. Crossing the far side of a node is the
+ * last thing done at that node, so it reuses the frame instead of stacking a
+ * new one. Trees deeper than the stack carry on in a nested call with a
+ * fresh stack. It walks the compiled nodes; SV_RecursiveHullCheck walks the
+ * clipnodes as loaded and stays as the reference for sv_tracebench.
+ */
+
+#define	MAX_HULL_STACK	256
+
+typedef struct
+{
+	int num;
+	int side;
+	float frac;
+	float p1f, midf, p2f;
+	vec3_t p1, mid, p2;
+} hullframe_t;
+
+bool SV_HullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t start, vec3_t end, trace_t *trace)
+{
+	hullframe_t stack[MAX_HULL_STACK];
+	int depth = 0;
+	vec3_t p1, p2;
+	bool empty;
+
+	VectorCopy(start, p1);
+	VectorCopy(end, p2);
+
+	for (;;)
+	{
+		// go down the near side until a leaf
+		while (num >= 0)
+		{
+			float t1, t2;
+			mclipnode_t *node = &hull->nodes[num];
+
+			if (node->type < 3)
+			{
+				t1 = p1[node->type] - node->dist;
+				t2 = p2[node->type] - node->dist;
+			}
+			else
+			{
+				t1 = DotProduct(node->normal, p1) - node->dist;
+				t2 = DotProduct(node->normal, p2) - node->dist;
+			}
+
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+			if (depth == MAX_HULL_STACK)
+				break;
+
+			// put the crosspoint DIST_EPSILON pixels on the near side
+			hullframe_t *frame = &stack[depth++];
+			float frac;
+			if (t1 < 0)
+				frac = (t1 + DIST_EPSILON) / (t1 - t2);
+			else
+				frac = (t1 - DIST_EPSILON) / (t1 - t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+
+			frame->num = num;
+			frame->side = (t1 < 0);
+			frame->frac = frac;
+			frame->p1f = p1f;
+			frame->p2f = p2f;
+			frame->midf = p1f + (p2f - p1f) * frac;
+			VectorCopy(p1, frame->p1);
+			VectorCopy(p2, frame->p2);
+			for (size_t i = 0; i < 3; i++)
+				frame->mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+
+			// move up to the node
+			num = node->children[frame->side];
+			p2f = frame->midf;
+			VectorCopy(frame->mid, p2);
+		}
+
+		if (num >= 0)
+		{
+			empty = SV_HullCheck(hull, num, p1f, p2f, p1, p2, trace);
+		}
+		else
+		{
+			switch (num)
+			{
+			case CONTENTS_SOLID:
+				trace->startsolid = true;
+				break;
+			case CONTENTS_EMPTY:
+				trace->allsolid = false;
+				trace->inopen = true;
+				break;
+			default:
+				trace->allsolid = false;
+				trace->inwater = true;
+				break;
+			}
+			empty = true;
+		}
+
+		if (!empty)
+			return false;
+		if (!depth)
+			return true;
+
+		hullframe_t *frame = &stack[--depth];
+		mclipnode_t *node = &hull->nodes[frame->num];
+		int side = frame->side;
+
+		if (SV_HullPointContents(hull, node->children[side ^ 1], frame->mid) != CONTENTS_SOLID)
+		{
+			// go past the node
+			num = node->children[side ^ 1];
+			p1f = frame->midf;
+			p2f = frame->p2f;
+			VectorCopy(frame->mid, p1);
+			VectorCopy(frame->p2, p2);
+			continue;
+		}
+
+		if (trace->allsolid)
+			return false; // never got out of the solid area
+
+		// the other side of the node is solid, this is the impact point
+		if (!side)
+		{
+			VectorCopy(node->normal, trace->plane.normal);
+			trace->plane.dist = node->dist;
+		}
+		else
+		{
+			VectorSubtract(vec3_origin, node->normal, trace->plane.normal);
+			trace->plane.dist = -node->dist;
+		}
+
+		// shouldn't really happen, but does occasionally
+		float frac = frame->frac;
+		float midf = frame->midf;
+		vec_t *mid = frame->mid;
+		while (SV_HullPointContents(hull, hull->firstnode, mid) == CONTENTS_SOLID)
+		{
+			frac -= 0.1;
+			if (frac < 0)
+			{
+				trace->fraction = midf;
+				VectorCopy(mid, trace->endpos);
+				return false;
+			}
+			midf = frame->p1f + (frame->p2f - frame->p1f) * frac;
+			for (size_t i = 0; i < 3; i++)
+				mid[i] = frame->p1[i] + frac * (frame->p2[i] - frame->p1[i]);
+		}
+
+		trace->fraction = midf;
+		VectorCopy(mid, trace->endpos);
+
+		return false;
+	}
+}
+
+static bool SV_TracesEqual(trace_t *a, trace_t *b)
+{
+	return a->allsolid == b->allsolid && a->startsolid == b->startsolid && a->inopen == b->inopen && a->inwater == b->inwater &&
+		a->fraction == b->fraction && VectorCompare(a->endpos, b->endpos) &&
+		VectorCompare(a->plane.normal, b->plane.normal) && a->plane.dist == b->plane.dist;
+}
+
+static void SV_TraceInit(trace_t *trace, vec3_t end)
+{
+	memset(trace, 0, sizeof(*trace));
+	trace->fraction = 1;
+	trace->allsolid = true;
+	VectorCopy(end, trace->endpos);
+}
+
+/*
+ * Traces random lines through each world hull with both tracers, counts
+ * the results that differ, then times them. Point contents likewise on the
+ * loaded and compiled clipnodes, with their sizes. Then does the same for whole
+ * moves, one at a time against batched.
+ */
+static void SV_TraceBench_f(void)
+{
+	int count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+	vec3_t *starts, *ends;
+	trace_t trace, check;
+	double start, times[2];
+
+	if (!sv.active)
+	{
+		Con_Printf("sv_tracebench: no map running\n");
+		return;
+	}
+	if (count < 1)
+		count = 1;
+
+	brush_model_t *brushmodel = sv.worldmodel->brushmodel;
+	starts = (vec3_t *) Q_malloc(count * sizeof(vec3_t));
+	ends = (vec3_t *) Q_malloc(count * sizeof(vec3_t));
+
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			starts[i][j] = sv.worldmodel->mins[j] + (sv.worldmodel->maxs[j] - sv.worldmodel->mins[j]) * (rand() / (float) RAND_MAX);
+			ends[i][j] = starts[i][j] + (rand() % 1024) - 512;
+		}
+	}
+
+	for (int h = 0; h < 3; h++)
+	{
+		hull_t *hull = &brushmodel->hulls[h];
+		int diffs = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			SV_TraceInit(&trace, ends[i]);
+			SV_TraceInit(&check, ends[i]);
+			SV_RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, starts[i], ends[i], &check);
+			SV_HullCheck(hull, hull->firstnode, 0, 1, starts[i], ends[i], &trace);
+			diffs += !SV_TracesEqual(&trace, &check);
+		}
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			start = Sys_DoubleTime();
+			for (int i = 0; i < count; i++)
+			{
+				SV_TraceInit(&trace, ends[i]);
+				if (pass == 0)
+					SV_RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, starts[i], ends[i], &trace);
+				else
+					SV_HullCheck(hull, hull->firstnode, 0, 1, starts[i], ends[i], &trace);
+			}
+			times[pass] = Sys_DoubleTime() - start;
+		}
+
+		Con_Printf("hull %i: %i of %i traces differ, recursive %.0f, iterative %.0f traces/sec\n", h, diffs, count,
+			   count / max(times[0], 0.001), count / max(times[1], 0.001));
+
+		// point contents on both layouts
+		int sink = 0;
+		diffs = 0;
+		for (int i = 0; i < count; i++)
+			diffs += SV_ClipnodePointContents(hull, hull->firstclipnode, starts[i]) != SV_HullPointContents(hull, hull->firstnode, starts[i]);
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			start = Sys_DoubleTime();
+			for (int i = 0; i < count; i++)
+			{
+				if (pass == 0)
+					sink += SV_ClipnodePointContents(hull, hull->firstclipnode, starts[i]);
+				else
+					sink += SV_HullPointContents(hull, hull->firstnode, starts[i]);
+			}
+			times[pass] = Sys_DoubleTime() - start;
+		}
+
+		Con_Printf("hull %i: %i of %i points differ, clipnodes %.0f, compiled %.0f points/sec (%i)\n", h, diffs, count,
+			   count / max(times[0], 0.001), count / max(times[1], 0.001), sink);
+		Con_Printf("hull %i: %i clipnodes %i bytes + %i planes %i bytes, %i compiled nodes %i bytes\n", h,
+			   hull->lastclipnode + 1, (int) ((hull->lastclipnode + 1) * sizeof(dclipnode_t)),
+			   brushmodel->numplanes, (int) (brushmodel->numplanes * sizeof(mplane_t)),
+			   hull->numnodes, (int) (hull->numnodes * sizeof(mclipnode_t)));
+	}
+
+	// the same lines against entities too, alone and in batches of eight around a point
+	vec3_t boxmins = { -16, -16, -24 }, boxmaxs = { 16, 16, 32 };
+	trace_t batch[8];
+	int diffs = 0;
+
+	for (int i = 0; i < count; i++)
+		VectorCopy(starts[i & ~7], starts[i]);
+
+	for (int i = 0; i + 8 <= count; i += 8)
+	{
+		SV_MoveBatch(starts + i, ends + i, 8, boxmins, boxmaxs, MOVE_NORMAL, NULL, batch);
+		for (int j = 0; j < 8; j++)
+		{
+			trace = SV_Move(starts[i + j], boxmins, boxmaxs, ends[i + j], MOVE_NORMAL, NULL);
+			diffs += !SV_TracesEqual(&trace, &batch[j]) || trace.ent != batch[j].ent;
+		}
+	}
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		start = Sys_DoubleTime();
+		for (int i = 0; i + 8 <= count; i += 8)
+		{
+			if (pass == 0)
+			{
+				for (int j = 0; j < 8; j++)
+					batch[j] = SV_Move(starts[i + j], boxmins, boxmaxs, ends[i + j], MOVE_NORMAL, NULL);
+			}
+			else
+			{
+				SV_MoveBatch(starts + i, ends + i, 8, boxmins, boxmaxs, MOVE_NORMAL, NULL, batch);
+			}
+		}
+		times[pass] = Sys_DoubleTime() - start;
+	}
+
+	Con_Printf("moves: %i of %i differ, single %.0f, batched %.0f moves/sec\n", diffs, count & ~7,
+		   (count & ~7) / max(times[0], 0.001), (count & ~7) / max(times[1], 0.001));
+
+	free(starts);
+	free(ends);
+}
+
+static void SV_AreaNodeQuery(areanode_t *node, int list, vec3_t mins, vec3_t maxs, edict_t **out, int *count)
+{
+	link_t *head = (list == AREA_TRIGGER) ? &node->trigger_edicts : &node->solid_edicts;
+
+	for (link_t *l = head->next; l != head; l = l->next)
+		out[(*count)++] = EDICT_FROM_AREA(l);
+
+	if (node->axis == -1)
+		return;
+
+	if (maxs[node->axis] > node->dist)
+		SV_AreaNodeQuery(node->children[0], list, mins, maxs, out, count);
+	if (mins[node->axis] < node->dist)
+		SV_AreaNodeQuery(node->children[1], list, mins, maxs, out, count);
+}
+
+/* Keeps the edicts whose abs box meets the box */
+static int SV_AreaFilter(vec3_t mins, vec3_t maxs, edict_t **list, int count)
+{
+	int kept = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		edict_t *e = list[i];
+		if (mins[0] > e->v.absmax[0] || mins[1] > e->v.absmax[1] || mins[2] > e->v.absmax[2]
+				|| maxs[0] < e->v.absmin[0] || maxs[1] < e->v.absmin[1] || maxs[2] < e->v.absmin[2])
+			continue;
+		list[kept++] = e;
+	}
+
+	return kept;
+}
+
+static int SV_AreaCompare(const void *a, const void *b)
+{
+	edict_t *e1 = *(edict_t **) a, *e2 = *(edict_t **) b;
+
+	return (e1 > e2) - (e1 < e2);
+}
+
+/*
+ * Puts every linked edict into a fresh area tree, and into the area nodes if
+ * the map runs on the tree, then runs the same queries through both: a box
+ * swept from a solid edict for clipping, and an edict's own box for the
+ * triggers it touches. Reports the results that differ, the query rates and
+ * the shape of each structure.
+ */
+static void SV_AreaBench_f(void)
+{
+	int count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+	edict_t **ents, **list1, **list2;
+	int numents = 0, numsolid = 0;
+
+	if (!sv.active)
+	{
+		Con_Printf("sv_areabench: no map running\n");
+		return;
+	}
+	if (count < 1)
+		count = 1;
+
+	ents = (edict_t **) Q_malloc(sv.num_edicts * sizeof(edict_t *));
+	list1 = (edict_t **) Q_malloc(sv.num_edicts * sizeof(edict_t *));
+	list2 = (edict_t **) Q_malloc(sv.num_edicts * sizeof(edict_t *));
+
+	for (int i = 1; i < sv.num_edicts; i++)
+	{
+		edict_t *e = EDICT_NUM(i);
+		if (e->area.prev || (e->arealeaf && sv_tree.nodes[e->arealeaf - 1].linked))
+			ents[numents++] = e;
+	}
+
+	// the solid edicts go first
+	for (int i = 0; i < numents; i++)
+	{
+		if (ents[i]->v.solid != SOLID_TRIGGER)
+		{
+			edict_t *e = ents[numsolid];
+			ents[numsolid++] = ents[i];
+			ents[i] = e;
+		}
+	}
+
+	if (!numsolid)
+	{
+		Con_Printf("sv_areabench: no solid edicts linked\n");
+		free(ents);
+		free(list1);
+		free(list2);
+		return;
+	}
+
+	if (sv_usetree)
+	{
+		for (int i = 0; i < numents; i++)
+			SV_AreaLinkEdict(ents[i]);
+	}
+
+	areatree_t tree;
+	tree.nodes = NULL;
+	SV_TreeClear(&tree);
+	for (int i = 0; i < numents; i++)
+	{
+		int leaf = SV_TreeInsert(&tree, (ents[i]->v.solid == SOLID_TRIGGER) ? AREA_TRIGGER : AREA_SOLID, ents[i]);
+		tree.nodes[leaf].linked = true;
+	}
+
+	// swept boxes for clipping, own boxes for touching
+	vec3_t *mins = (vec3_t *) Q_malloc(count * 2 * sizeof(vec3_t));
+	vec3_t *maxs = mins + count;
+
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		edict_t *e = ents[rand() % numsolid];
+		VectorCopy(e->v.absmin, mins[i]);
+		VectorCopy(e->v.absmax, maxs[i]);
+		if (i & 1)
+			continue;
+
+		for (int j = 0; j < 3; j++)
+		{
+			float move = (rand() % 513) - 256;
+			if (move < 0)
+				mins[i][j] += move;
+			else
+				maxs[i][j] += move;
 		}
-
-		return true; // empty
 	}
 
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		Sys_Error("bad node number");
+	const char *names[2] = { "clip", "touch" };
+	for (int kind = 0; kind < 2; kind++)
+	{
+		int list = kind ? AREA_TRIGGER : AREA_SOLID;
+		int diffs = 0, found = 0;
+		double start, times[2];
 
-	// find the point distances
-	float t1, t2;
+		for (int i = kind; i < count; i += 2)
+		{
+			int count1 = 0;
+			SV_AreaNodeQuery(sv_areanodes, list, mins[i], maxs[i], list1, &count1);
+			count1 = SV_AreaFilter(mins[i], maxs[i], list1, count1);
+			int count2 = SV_AreaFilter(mins[i], maxs[i], list2, SV_TreeQuery(&tree, list, mins[i], maxs[i], list2));
+
+			qsort(list1, count1, sizeof(edict_t *), SV_AreaCompare);
+			qsort(list2, count2, sizeof(edict_t *), SV_AreaCompare);
+			diffs += count1 != count2 || memcmp(list1, list2, count1 * sizeof(edict_t *));
+			found += count1;
+		}
 
-	dclipnode_t *node = &hull->clipnodes[num];
-	mplane_t *plane = &hull->planes[node->planenum];
+		for (int pass = 0; pass < 2; pass++)
+		{
+			start = Sys_DoubleTime();
+			for (int i = kind; i < count; i += 2)
+			{
+				int n = 0;
+				if (pass == 0)
+					SV_AreaNodeQuery(sv_areanodes, list, mins[i], maxs[i], list1, &n);
+				else
+					n = SV_TreeQuery(&tree, list, mins[i], maxs[i], list1);
+				SV_AreaFilter(mins[i], maxs[i], list1, n);
+			}
+			times[pass] = Sys_DoubleTime() - start;
+		}
 
-	if (plane->type < 3)
+		int queries = (count - kind + 1) / 2;
+		Con_Printf("%s: %i of %i queries differ, %i hits, area nodes %.0f, tree %.0f queries/sec\n", names[kind], diffs, queries,
+			   found, queries / max(times[0], 0.001), queries / max(times[1], 0.001));
+	}
+
+	// edicts stuck above the area node leaves get checked by every query through them
+	int interior = 0, longest = 0;
+	for (int i = 0; i < sv_numareanodes; i++)
 	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
+		int length = 0;
+		for (link_t *l = sv_areanodes[i].solid_edicts.next; l != &sv_areanodes[i].solid_edicts; l = l->next)
+			length++;
+		for (link_t *l = sv_areanodes[i].trigger_edicts.next; l != &sv_areanodes[i].trigger_edicts; l = l->next)
+			length++;
+		if (sv_areanodes[i].axis != -1)
+			interior += length;
+		longest = max(longest, length);
 	}
-	else
+
+	Con_Printf("%i edicts, %i on area node splits, longest area node list %i\n", numents, interior, longest);
+	int treenodes = 2 * numents - 1 - (numents > numsolid); // a leaf per edict and a node per pair
+	Con_Printf("tree heights solid %i trigger %i, %i nodes %i bytes\n",
+		   tree.nodes[tree.roots[AREA_SOLID]].height,
+		   tree.roots[AREA_TRIGGER] == -1 ? 0 : tree.nodes[tree.roots[AREA_TRIGGER]].height,
+		   treenodes, (int) (treenodes * sizeof(areaproxy_t)));
+
+	if (sv_usetree)
 	{
-		t1 = DotProduct(plane->normal, p1) - plane->dist;
-		t2 = DotProduct(plane->normal, p2) - plane->dist;
+		for (int i = 0; i < numents; i++)
+		{
+			RemoveLink(&ents[i]->area);
+			ents[i]->area.prev = ents[i]->area.next = NULL;
+			sv_touchcache[NUM_FOR_EDICT(ents[i])].trigger_node = -1;
+		}
 	}
 
-	if (t1 >= 0 && t2 >= 0)
-		return SV_RecursiveHullCheck(hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return SV_RecursiveHullCheck(hull, node->children[1], p1f, p2f, p1, p2, trace);
+	SV_TreeClear(&tree);
+	free(mins);
+	free(ents);
+	free(list1);
+	free(list2);
+}
 
-	// put the crosspoint DIST_EPSILON pixels on the near side
-	float frac;
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON) / (t1 - t2);
-	else
-		frac = (t1 - DIST_EPSILON) / (t1 - t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
+/*
+ * Takes the next slot past the last edict, so free edicts the game may
+ * reuse are left alone and sv.num_edicts can be put back afterwards
+ */
+static edict_t *SV_BenchEdict(void)
+{
+	edict_t *e = EDICT_NUM(sv.num_edicts);
 
-	vec3_t mid;
-	for (size_t i = 0; i < 3; i++)
-		mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+	sv.num_edicts++;
+	memset(&e->v, 0, progs->entityfields * 4);
+	e->free = false;
+	ED_Dirty(e);
 
-	float midf = p1f + (p2f - p1f) * frac;
+	return e;
+}
 
-	int side = (t1 < 0);
+/*
+ * A trigger heavy scene: spawns triggers and boxes that wander among them,
+ * about half of the boxes standing still each frame. One run relinks a
+ * trigger every frame and checks every touch list against a fresh walk,
+ * then the frames are timed walking and with touch pairs. The edicts are
+ * freed again at the end.
+ */
+static void SV_TouchBench_f(void)
+{
+	int numtriggers = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 500;
+	int nummovers = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 200;
+	int frames = Cmd_Argc() > 3 ? atoi(Cmd_Argv(3)) : 100;
 
-	// move up to the node
-	if (!SV_RecursiveHullCheck(hull, node->children[side], p1f, midf, p1, mid, trace))
-		return false;
+	if (!sv.active)
+	{
+		Con_Printf("sv_touchbench: no map running\n");
+		return;
+	}
+	if (sv_usetree)
+	{
+		Con_Printf("sv_touchbench: touch pairs need the area nodes, sv_areatree 0\n");
+		return;
+	}
 
-#ifdef PARANOID
-	if (SV_HullPointContents(sv_hullmodel, mid, node->children[side]) == CONTENTS_SOLID)
+	if (MAX_EDICTS - sv.num_edicts < 2)
 	{
-		Con_Printf("mid PointInHullSolid\n");
-		return false;
+		Con_Printf("sv_touchbench: no free edicts\n");
+		return;
 	}
-#endif
 
-	if (SV_HullPointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID) // go past the node
-		return SV_RecursiveHullCheck(hull, node->children[side ^ 1], midf, p2f, mid, p2, trace);
+	numtriggers = CLAMP(1, numtriggers, (MAX_EDICTS - sv.num_edicts) / 2);
+	nummovers = CLAMP(1, nummovers, (MAX_EDICTS - sv.num_edicts) / 2);
+	frames = max(frames, 1);
 
-	if (trace->allsolid)
-		return false; // never got out of the solid area
+	edict_t **triggers = (edict_t **) Q_malloc(numtriggers * sizeof(edict_t *));
+	edict_t **movers = (edict_t **) Q_malloc(nummovers * sizeof(edict_t *));
+	vec3_t *origins = (vec3_t *) Q_malloc(nummovers * sizeof(vec3_t));
+	vec3_t boxmins = { -16, -16, -24 }, boxmaxs = { 16, 16, 32 };
+	float *wmins = sv.worldmodel->mins, *wmaxs = sv.worldmodel->maxs;
 
-	// the other side of the node is solid, this is the impact point
-	if (!side)
+	int oldnum = sv.num_edicts;
+
+	srand(1);
+	for (int i = 0; i < numtriggers; i++)
 	{
-		VectorCopy(plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
+		edict_t *e = triggers[i] = SV_BenchEdict();
+		e->v.solid = SOLID_TRIGGER;
+		for (int j = 0; j < 3; j++)
+		{
+			e->v.origin[j] = wmins[j] + (wmaxs[j] - wmins[j]) * (rand() / (float) RAND_MAX);
+			e->v.maxs[j] = 16 + rand() % 112;
+			e->v.mins[j] = -e->v.maxs[j];
+		}
+		VectorSubtract(e->v.maxs, e->v.mins, e->v.size);
+		SV_LinkEdict(e, false);
 	}
-	else
+
+	for (int i = 0; i < nummovers; i++)
 	{
-		VectorSubtract(vec3_origin, plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
+		edict_t *e = movers[i] = SV_BenchEdict();
+		e->v.solid = SOLID_BBOX;
+		for (int j = 0; j < 3; j++)
+			origins[i][j] = wmins[j] + (wmaxs[j] - wmins[j]) * (rand() / (float) RAND_MAX);
+		VectorCopy(boxmins, e->v.mins);
+		VectorCopy(boxmaxs, e->v.maxs);
+		VectorSubtract(e->v.maxs, e->v.mins, e->v.size);
 	}
 
-	// shouldn't really happen, but does occasionally
-	while (SV_HullPointContents(hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
+	unsigned int sums[3];
+	double times[3];
+	int diffs = 0, hits = 0, queries = 0;
+
+	// pass 0 checks, pass 1 walks, pass 2 uses the pairs
+	for (int pass = 0; pass < 3; pass++)
 	{
-		frac -= 0.1;
-		if (frac < 0)
+		for (int i = 0; i < nummovers; i++)
 		{
-			trace->fraction = midf;
-			VectorCopy(mid, trace->endpos);
-			// Con_DPrintf ("backup past 0\n"); // JPG - removed this (it was spamming big time)
-			return false;
+			VectorCopy(origins[i], movers[i]->v.origin);
+			SV_LinkEdict(movers[i], false);
 		}
-		midf = p1f + (p2f - p1f) * frac;
-		for (size_t i = 0; i < 3; i++)
-			mid[i] = p1[i] + frac * (p2[i] - p1[i]);
+
+		srand(2);
+		sums[pass] = 0;
+		int oldhits = sv_touchhits;
+		double start = Sys_DoubleTime();
+
+		for (int f = 0; f < frames; f++)
+		{
+			if (pass == 0)
+				SV_LinkEdict(triggers[f % numtriggers], false);
+
+			for (int i = 0; i < nummovers; i++)
+			{
+				edict_t *e = movers[i];
+
+				if (rand() & 1)
+				{
+					e->v.origin[0] += (rand() % 17) - 8;
+					e->v.origin[1] += (rand() % 17) - 8;
+					SV_LinkEdict(e, false);
+				}
+
+				// nothing here has a touch function, so the pairs are always refilled or kept
+				SV_TouchTriggers(e, pass != 1);
+
+				touchcache_t *cache = &sv_touchcache[NUM_FOR_EDICT(e)];
+				for (int k = 0; k < cache->numtouch; k++)
+					sums[pass] = sums[pass] * 31 + NUM_FOR_EDICT(cache->touch[k]);
+
+				if (pass == 0)
+				{
+					touchcache_t record;
+
+					record.numtouch = 0;
+					record.nodes = 0;
+					SV_TouchLinks(e, sv_areanodes, &record);
+					diffs += record.numtouch <= MAX_TOUCH_PAIRS && (!cache->stamp || record.numtouch != cache->numtouch
+							|| memcmp(record.touch, cache->touch, record.numtouch * sizeof(edict_t *)));
+					queries++;
+				}
+			}
+		}
+
+		times[pass] = Sys_DoubleTime() - start;
+		if (pass == 2)
+			hits = sv_touchhits - oldhits;
 	}
 
-	trace->fraction = midf;
-	VectorCopy(mid, trace->endpos);
+	Con_Printf("%i triggers, %i boxes, %i frames\n", numtriggers, nummovers, frames);
+	Con_Printf("%i of %i touch lists differ after trigger relinks, timed runs %s\n", diffs, queries, sums[1] == sums[2] ? "match" : "differ");
+	Con_Printf("walking %.0f, touch pairs %.0f lists/sec, %i of %i from pairs\n", frames * nummovers / max(times[1], 0.001),
+		   frames * nummovers / max(times[2], 0.001), hits, frames * nummovers);
 
-	return false;
-}
+	for (int i = 0; i < numtriggers; i++)
+		ED_Free(triggers[i]);
+	for (int i = 0; i < nummovers; i++)
+		ED_Free(movers[i]);
+	sv.num_edicts = oldnum;
 
+	free(triggers);
+	free(movers);
+	free(origins);
+}
 
+void SV_InitWorld(void)
+{
+	Cvar_RegisterVariable(&sv_areatree);
+	Cvar_RegisterVariable(&sv_touchpairs);
+	Cvar_RegisterVariable(&sv_leafcache);
+	Cvar_RegisterVariable(&sv_leafstats);
+	Cmd_AddCommand("sv_tracebench", SV_TraceBench_f);
+	Cmd_AddCommand("sv_areabench", SV_AreaBench_f);
+	Cmd_AddCommand("sv_touchbench", SV_TouchBench_f);
+}
 
 //Handles selection or creation of a clipping hull, and offseting (and eventually rotation) of the end points
 trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
@@ -626,7 +2070,7 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
 // ROTATE END
 
 // trace a line through the apropriate clipping hull
-	SV_RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+	SV_HullCheck(hull, hull->firstnode, 0, 1, start_l, end_l, &trace);
 
 // ROTATE START
 	// rotate endpos back to world frame of reference
@@ -676,6 +2120,73 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
 
 //===========================================================================
 
+/* The tests against touch that don't depend on where the move goes */
+static bool SV_CanClip(moveclip_t *clip, edict_t *touch)
+{
+	if (touch->v.solid == SOLID_NOT)
+		return false;
+	if (touch == clip->passedict)
+		return false;
+	if (touch->v.solid == SOLID_TRIGGER)
+		Sys_Error("Trigger in clipping list");
+
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return false;
+
+	return true;
+}
+
+static bool SV_BoxTouches(moveclip_t *clip, edict_t *touch)
+{
+	return !(clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2]
+		 || clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2]);
+}
+
+/* The tests between touch and the moving edict */
+static bool SV_OwnerClips(moveclip_t *clip, edict_t *touch)
+{
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return false; // points never interact
+
+	if (clip->passedict)
+	{
+		if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
+			return false; // don't clip against own missiles
+		if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
+			return false; // don't clip against owner
+	}
+
+	return true;
+}
+
+/* Clips the move against touch, keeping the nearest hit */
+static void SV_ClipToEdict(moveclip_t *clip, edict_t *touch)
+{
+	trace_t trace;
+
+	if ((int) touch->v.flags & FL_MONSTER)
+		trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+	else
+		trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end);
+	if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+		if (clip->trace.startsolid)
+		{
+			clip->trace = trace;
+			clip->trace.startsolid = true;
+		}
+		else
+		{
+			clip->trace = trace;
+		}
+	}
+	else if (trace.startsolid)
+	{
+		clip->trace.startsolid = true;
+	}
+}
+
 /*
  ====================
  SV_ClipToLinks
@@ -687,62 +2198,25 @@ static void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
 {
 	link_t *l, *next;
 	edict_t *touch;
-	trace_t trace;
 
 // touch linked edicts
 	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA(l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error("Trigger in clipping list");
-
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		if (!SV_CanClip(clip, touch))
 			continue;
 
-		if (clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] || clip->boxmins[2] > touch->v.absmax[2]
-				|| clip->boxmaxs[0] < touch->v.absmin[0] || clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2])
+		if (!SV_BoxTouches(clip, touch))
 			continue;
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue;	// points never interact
-
 		// might intersect, so do an exact clip
 		if (clip->trace.allsolid)
 			return;
-		if (clip->passedict)
-		{
-			if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
-				continue;	// don't clip against own missiles
-			if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
-				continue;	// don't clip against owner
-		}
+		if (!SV_OwnerClips(clip, touch))
+			continue;
 
-		if ((int) touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end);
-		else
-			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end);
-		if (trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction)
-		{
-			trace.ent = touch;
-			if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-			{
-				clip->trace = trace;
-			}
-		}
-		else if (trace.startsolid)
-		{
-			clip->trace.startsolid = true;
-		}
+		SV_ClipToEdict(clip, touch);
 	}
 
 // recurse down both sides
@@ -755,6 +2229,30 @@ static void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
 		SV_ClipToLinks(node->children[1], clip);
 }
 
+/* SV_ClipToLinks for the area tree */
+static void SV_ClipToTree(moveclip_t *clip)
+{
+	edict_t *list[MAX_EDICTS];
+	int count = SV_TreeQuery(&sv_tree, AREA_SOLID, clip->boxmins, clip->boxmaxs, list);
+
+	for (int i = 0; i < count; i++)
+	{
+		edict_t *touch = list[i];
+		if (!SV_CanClip(clip, touch))
+			continue;
+
+		if (!SV_BoxTouches(clip, touch))
+			continue;
+
+		if (clip->trace.allsolid)
+			return;
+		if (!SV_OwnerClips(clip, touch))
+			continue;
+
+		SV_ClipToEdict(clip, touch);
+	}
+}
+
 static void SV_MoveBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t boxmins, vec3_t boxmaxs)
 {
 	int i;
@@ -787,41 +2285,145 @@ static void SV_MoveBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, ve
  *
  * passedict is explicitly excluded from clipping checks (normally NULL)
  */
-trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static void SV_InitMoveClip(moveclip_t *clip, vec3_t mins, vec3_t maxs, int type, edict_t *passedict)
 {
-	moveclip_t clip;
-
-	memset(&clip, 0, sizeof(moveclip_t));
-
-	// clip to world
-	clip.trace = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end);
+	memset(clip, 0, sizeof(moveclip_t));
 
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.type = type;
-	clip.passedict = passedict;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
 
 	if (type == MOVE_MISSILE)
 	{
 		for (int i = 0; i < 3; i++)
 		{
-			clip.mins2[i] = -15;
-			clip.maxs2[i] = 15;
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
 		}
 	}
 	else
 	{
-		VectorCopy(mins, clip.mins2);
-		VectorCopy(maxs, clip.maxs2);
+		VectorCopy(mins, clip->mins2);
+		VectorCopy(maxs, clip->maxs2);
 	}
+}
+
+trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	// clip to world
+	trace_t world = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end);
+
+	return SV_MoveEntities(&world, start, mins, maxs, end, type, passedict);
+}
+
+/*
+ * The rest of SV_Move, for a move whose clip against the world is already
+ * known. The world doesn't change within a frame, so that clip can be
+ * worked out ahead of time and on any thread.
+ */
+trace_t SV_MoveEntities(trace_t *world, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t clip;
+
+	SV_InitMoveClip(&clip, mins, maxs, type, passedict);
+
+	clip.trace = *world;
+
+	clip.start = start;
+	clip.end = end;
 
 	// create the bounding box of the entire move
 	SV_MoveBounds(start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs);
 
 	// clip to entities
-	SV_ClipToLinks(sv_areanodes, &clip);
+	if (sv_usetree)
+		SV_ClipToTree(&clip);
+	else
+		SV_ClipToLinks(sv_areanodes, &clip);
 
 	return clip.trace;
 }
+
+/*
+ * Collects the edicts a batch of moves could clip against, in the order
+ * SV_ClipToLinks would reach them, doing the tests that don't depend on
+ * the line once for the whole batch. clip's box covers every move.
+ */
+static void SV_GatherLinks(areanode_t *node, moveclip_t *clip, edict_t **list, int *count)
+{
+	for (link_t *l = node->solid_edicts.next; l != &node->solid_edicts; l = l->next)
+	{
+		edict_t *touch = EDICT_FROM_AREA(l);
+
+		if (SV_CanClip(clip, touch) && SV_BoxTouches(clip, touch) && SV_OwnerClips(clip, touch))
+			list[(*count)++] = touch;
+	}
+
+	if (node->axis == -1)
+		return;
+
+	if (clip->boxmaxs[node->axis] > node->dist)
+		SV_GatherLinks(node->children[0], clip, list, count);
+	if (clip->boxmins[node->axis] < node->dist)
+		SV_GatherLinks(node->children[1], clip, list, count);
+}
+
+/*
+ * Same as calling SV_Move for every start/end pair, but the area nodes
+ * are walked once for all of them. An edict left out by the walk for one
+ * move lies outside that move's box, so checking the gathered list
+ * against each box finds the same edicts in the same order.
+ */
+void SV_MoveBatch(vec3_t *starts, vec3_t *ends, int count, vec3_t mins, vec3_t maxs, int type, edict_t *passedict, trace_t *traces)
+{
+	moveclip_t clip;
+	edict_t *list[MAX_EDICTS];
+	int numlist = 0;
+	vec3_t boxmins, boxmaxs;
+
+	if (count <= 0)
+		return;
+
+	SV_InitMoveClip(&clip, mins, maxs, type, passedict);
+
+	for (int i = 0; i < count; i++)
+	{
+		SV_MoveBounds(starts[i], clip.mins2, clip.maxs2, ends[i], boxmins, boxmaxs);
+		for (int j = 0; j < 3; j++)
+		{
+			clip.boxmins[j] = i ? min(clip.boxmins[j], boxmins[j]) : boxmins[j];
+			clip.boxmaxs[j] = i ? max(clip.boxmaxs[j], boxmaxs[j]) : boxmaxs[j];
+		}
+	}
+	if (sv_usetree)
+	{
+		int numtree = SV_TreeQuery(&sv_tree, AREA_SOLID, clip.boxmins, clip.boxmaxs, list);
+
+		for (int i = 0; i < numtree; i++)
+		{
+			if (SV_CanClip(&clip, list[i]) && SV_BoxTouches(&clip, list[i]) && SV_OwnerClips(&clip, list[i]))
+				list[numlist++] = list[i];
+		}
+	}
+	else
+	{
+		SV_GatherLinks(sv_areanodes, &clip, list, &numlist);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		clip.trace = SV_ClipMoveToEntity(sv.edicts, starts[i], mins, maxs, ends[i]);
+		clip.start = starts[i];
+		clip.end = ends[i];
+		SV_MoveBounds(starts[i], clip.mins2, clip.maxs2, ends[i], clip.boxmins, clip.boxmaxs);
+
+		for (int j = 0; j < numlist && !clip.trace.allsolid; j++)
+		{
+			if (SV_BoxTouches(&clip, list[j]))
+				SV_ClipToEdict(&clip, list[j]);
+		}
+
+		traces[i] = clip.trace;
+	}
+}
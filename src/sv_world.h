@@ -48,12 +48,19 @@ typedef struct
 #define	AREA_DEPTH      4
 #define	AREA_NODES      32
 
+void SV_InitWorld(void);
 void SV_ClearWorld(void);
+void SV_LeafStats(void);
 void SV_UnlinkEdict(edict_t *ent);
+void SV_RemoveEdict(edict_t *ent);
 void SV_LinkEdict(edict_t *ent, bool touch_triggers);
 int SV_PointContents(vec3_t p);
 edict_t *SV_TestEntityPosition(edict_t *ent);
 bool SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+bool SV_HullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end);
 trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+trace_t SV_MoveEntities(trace_t *world, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+void SV_MoveBatch(vec3_t *starts, vec3_t *ends, int count, vec3_t mins, vec3_t maxs, int type, edict_t *passedict, trace_t *traces);
 
 #endif /* __WORLD_H */
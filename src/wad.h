@@ -66,6 +66,8 @@ typedef struct
 } lumpinfo_t;
 
 void SwapPic(dqpic_t *pic);
+extern byte *wad_base;
+
 void W_LoadWadFile(const char *filename);
 void *W_GetLumpName(const char *name);
 